@@ -1,8 +1,11 @@
 #include "devices/block.h"
 #include <list.h>
+#include <stdbool.h>
 #include <string.h>
 #include <stdio.h>
 #include "devices/ide.h"
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
 
 /* A block device. */
@@ -17,8 +20,9 @@ struct block
     const struct block_operations *ops;  /* Driver operations. */
     void *aux;                          /* Extra data owned by driver. */
 
-    unsigned long long read_cnt;        /* Number of sectors read. */
-    unsigned long long write_cnt;       /* Number of sectors written. */
+    struct block_stats stats;           /* I/O statistics. */
+    unsigned in_flight;                 /* Requests currently submitted. */
+    block_sector_t next_sector;         /* Sector after the last request. */
   };
 
 /* List of all block devices. */
@@ -28,6 +32,8 @@ static struct list all_blocks = LIST_INITIALIZER (all_blocks);
 static struct block *block_by_role[BLOCK_ROLE_CNT];
 
 static struct block *list_elem_to_block (struct list_elem *);
+static uint64_t begin_request (struct block *, block_sector_t);
+static void end_request (struct block *, uint64_t start, bool write);
 
 /* Returns a human-readable name for the given block device
    TYPE. */
@@ -120,9 +126,12 @@ check_sector (struct block *block, block_sector_t sector)
 void
 block_read (struct block *block, block_sector_t sector, void *buffer)
 {
+  uint64_t start;
+
   check_sector (block, sector);
+  start = begin_request (block, sector);
   block->ops->read (block->aux, sector, buffer);
-  block->read_cnt++;
+  end_request (block, start, false);
 }
 
 /* Write sector SECTOR to BLOCK from BUFFER, which must contain
@@ -133,10 +142,13 @@ block_read (struct block *block, block_sector_t sector, void *buffer)
 void
 block_write (struct block *block, block_sector_t sector, const void *buffer)
 {
+  uint64_t start;
+
   check_sector (block, sector);
   ASSERT (block->type != BLOCK_FOREIGN);
+  start = begin_request (block, sector);
   block->ops->write (block->aux, sector, buffer);
-  block->write_cnt++;
+  end_request (block, start, true);
 }
 
 /* Returns the number of sectors in BLOCK. */
@@ -160,6 +172,27 @@ block_type (struct block *block)
   return block->type;
 }
 
+/* Prints latency histogram HISTOGRAM for the CNT requests of
+   kind WHAT on BLOCK, which took CYCLES TSC cycles in total.
+   Only nonempty buckets are printed, as "log2:count" pairs. */
+static void
+print_latency (struct block *block, const char *what,
+               const unsigned histogram[BLOCK_LATENCY_BUCKETS],
+               unsigned long long cnt, unsigned long long cycles)
+{
+  int i;
+
+  if (cnt == 0)
+    return;
+
+  printf ("%s: %s latency avg %llu cycles, log2 histogram:",
+          block->name, what, cycles / cnt);
+  for (i = 0; i < BLOCK_LATENCY_BUCKETS; i++)
+    if (histogram[i] != 0)
+      printf (" %d:%u", i, histogram[i]);
+  printf ("\n");
+}
+
 /* Prints statistics for each block device used for a Pintos role. */
 void
 block_print_stats (void)
@@ -171,17 +204,44 @@ block_print_stats (void)
       struct block *block = block_by_role[i];
       if (block != NULL)
         {
+          struct block_stats *s = &block->stats;
+          unsigned long long requests = s->read_cnt + s->write_cnt;
+
           printf ("%s (%s): %llu reads, %llu writes\n",
                   block->name, block_type_name (block->type),
-                  block->read_cnt, block->write_cnt);
+                  s->read_cnt, s->write_cnt);
+          if (requests == 0)
+            continue;
+
+          printf ("%s: %llu bytes read, %llu bytes written, "
+                  "%llu sequential, %llu random, "
+                  "queue depth avg %llu.%02llu max %u\n",
+                  block->name, s->bytes_read, s->bytes_written,
+                  s->seq_cnt, s->random_cnt,
+                  s->depth_sum / requests,
+                  s->depth_sum * 100 / requests % 100, s->max_depth);
+          print_latency (block, "read", s->read_latency,
+                         s->read_cnt, s->read_cycles);
+          print_latency (block, "write", s->write_latency,
+                         s->write_cnt, s->write_cycles);
         }
     }
 }
 
+/* Copies a consistent snapshot of BLOCK's statistics into
+   *STATS. */
+void
+block_get_stats (struct block *block, struct block_stats *stats)
+{
+  enum intr_level old_level = intr_disable ();
+  *stats = block->stats;
+  intr_set_level (old_level);
+}
+
 unsigned long long
 get_write_cnt (void)
 {
-  return block_get_role (BLOCK_FILESYS)->write_cnt;
+  return block_get_role (BLOCK_FILESYS)->stats.write_cnt;
 }
 
 /* Registers a new block device with the given NAME.  If
@@ -204,8 +264,9 @@ block_register (const char *name, enum block_type type,
   block->size = size;
   block->ops = ops;
   block->aux = aux;
-  block->read_cnt = 0;
-  block->write_cnt = 0;
+  memset (&block->stats, 0, sizeof block->stats);
+  block->in_flight = 0;
+  block->next_sector = 0;
 
   printf ("%s: %'"PRDSNu" sectors (", block->name, block->size);
   print_human_readable_size ((uint64_t) block->size * BLOCK_SECTOR_SIZE);
@@ -227,3 +288,71 @@ list_elem_to_block (struct list_elem *list_elem)
           : NULL);
 }
 
+
+/* Returns the latency histogram bucket for a request that took
+   CYCLES TSC cycles, that is, floor(log2(CYCLES)), capped at the
+   last bucket. */
+static unsigned
+latency_bucket (uint64_t cycles)
+{
+  unsigned bucket = 0;
+
+  while (cycles >>= 1)
+    bucket++;
+  return bucket < BLOCK_LATENCY_BUCKETS ? bucket : BLOCK_LATENCY_BUCKETS - 1;
+}
+
+/* Accounts for a new request for SECTOR on BLOCK: its queue depth
+   and whether it continues the previous request sequentially.
+   Returns the TSC value at submission, to be passed to
+   end_request(). */
+static uint64_t
+begin_request (struct block *block, block_sector_t sector)
+{
+  struct block_stats *s = &block->stats;
+  enum intr_level old_level;
+  unsigned depth;
+
+  old_level = intr_disable ();
+  depth = ++block->in_flight;
+  s->depth_sum += depth;
+  if (depth > s->max_depth)
+    s->max_depth = depth;
+  if (sector == block->next_sector)
+    s->seq_cnt++;
+  else
+    s->random_cnt++;
+  block->next_sector = sector + 1;
+  intr_set_level (old_level);
+
+  return rdtsc ();
+}
+
+/* Accounts for the completion of a request on BLOCK that was
+   submitted at TSC value START.  WRITE distinguishes writes from
+   reads. */
+static void
+end_request (struct block *block, uint64_t start, bool write)
+{
+  struct block_stats *s = &block->stats;
+  uint64_t cycles = rdtsc () - start;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  block->in_flight--;
+  if (write)
+    {
+      s->write_cnt++;
+      s->bytes_written += BLOCK_SECTOR_SIZE;
+      s->write_cycles += cycles;
+      s->write_latency[latency_bucket (cycles)]++;
+    }
+  else
+    {
+      s->read_cnt++;
+      s->bytes_read += BLOCK_SECTOR_SIZE;
+      s->read_cycles += cycles;
+      s->read_latency[latency_bucket (cycles)]++;
+    }
+  intr_set_level (old_level);
+}
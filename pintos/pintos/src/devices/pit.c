@@ -11,9 +11,6 @@
 #define PIT_PORT_CONTROL          0x43                /* Control port. */
 #define PIT_PORT_COUNTER(CHANNEL) (0x40 + (CHANNEL))  /* Counter port. */
 
-/* PIT cycles per second. */
-#define PIT_HZ 1193180
-
 /* Configure the given CHANNEL in the PIT.  In a PC, the PIT's
    three output channels are hooked up like this:
 
@@ -81,3 +78,45 @@ pit_configure_channel (int channel, int mode, int frequency)
   outb (PIT_PORT_COUNTER (channel), count >> 8);
   intr_set_level (old_level);
 }
+
+/* Starts channel 0 counting down COUNT PIT cycles, which must be
+   nonzero, in mode 0 ("interrupt on terminal count").  The
+   channel's output, and with it interrupt line 0, rises once
+   when the count reaches 0 and then stays high, so that the
+   timer interrupts just once, until the channel is configured
+   again. */
+void
+pit_oneshot (uint16_t count)
+{
+  enum intr_level old_level;
+
+  ASSERT (count != 0);
+
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, 0x30);
+  outb (PIT_PORT_COUNTER (0), count);
+  outb (PIT_PORT_COUNTER (0), count >> 8);
+  intr_set_level (old_level);
+}
+
+/* Returns the number of PIT cycles left in channel 0's current
+   count, using the read-back command.  If OUT is nonnull, stores
+   the state of the channel's output in *OUT: in mode 0, true
+   once the count has run out. */
+uint16_t
+pit_read (bool *out)
+{
+  enum intr_level old_level;
+  uint8_t status, lo, hi;
+
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, 0xc2);        /* Latch status and count. */
+  status = inb (PIT_PORT_COUNTER (0));
+  lo = inb (PIT_PORT_COUNTER (0));
+  hi = inb (PIT_PORT_COUNTER (0));
+  intr_set_level (old_level);
+
+  if (out != NULL)
+    *out = (status & 0x80) != 0;
+  return lo | (hi << 8);
+}
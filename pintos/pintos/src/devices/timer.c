@@ -1,25 +1,66 @@
 #include "devices/timer.h"
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stdio.h>
 #include "devices/pit.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 
 /* See [8254] for hardware details of the 8254 timer chip. */
 
-#if TIMER_FREQ < 19
-#error 8254 timer requires TIMER_FREQ >= 19
-#endif
-#if TIMER_FREQ > 1000
-#error TIMER_FREQ <= 1000 recommended
-#endif
+/* Number of timer ticks per second. */
+int timer_freq = TIMER_FREQ_DEFAULT;
+
+/* PIT cycles per timer tick. */
+static unsigned pit_per_tick = (PIT_HZ + TIMER_FREQ_DEFAULT / 2)
+                               / TIMER_FREQ_DEFAULT;
 
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/* Tickless idle.
+
+   While the idle thread sleeps through ticks, the PIT runs in
+   one-shot mode, loaded with nohz_ticks > 0 ticks' worth of
+   cycles and lined up so that the ticks fall where periodic ticks
+   would have.  The interrupt at the end of the count accounts for
+   all of them at once and restarts periodic ticks.  An earlier
+   interrupt from another device cuts the sleep short (see
+   timer_irq_enter()). */
+bool timer_tickless;
+static int nohz_ticks;
+static int64_t nohz_sleeps;             /* Tickless sleeps started. */
+static int64_t nohz_skipped;            /* Ticks without an interrupt. */
+
+/* Hierarchical timer wheel, after Varghese and Lauck's "Hashed
+   and Hierarchical Timing Wheels".
+
+   wheel_ticks is the next tick that the wheel has yet to
+   process.  A timer expiring within ROOT_SLOTS ticks of it sits
+   in root slot (expires % ROOT_SLOTS), and expires when that slot
+   is processed.  A timer further out sits in the first of the
+   LEVEL_CNT coarser levels whose range covers it, each of whose
+   slots spans LEVEL_SLOTS times as many ticks as the level below.
+   Whenever the root wraps around, the current slot of level 0 is
+   emptied back into the wheel ("cascaded"), which spreads its
+   timers over the root; when level 0 wraps around, level 1's
+   current slot is cascaded, and so on.  A timer more than
+   2**32 ticks out waits in the last level and is cascaded again
+   until it comes within range. */
+#define ROOT_BITS 8
+#define ROOT_SLOTS (1 << ROOT_BITS)
+#define LEVEL_BITS 6
+#define LEVEL_SLOTS (1 << LEVEL_BITS)
+#define LEVEL_CNT 4
+static struct list wheel_root[ROOT_SLOTS];
+static struct list wheel_levels[LEVEL_CNT][LEVEL_SLOTS];
+static int64_t wheel_ticks;
+static int timer_cnt;                   /* Number of pending timers. */
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
@@ -29,16 +70,125 @@ static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
+static void wheel_insert (struct timer *);
+static void run_timers (void);
+static void advance_ticks (int cnt);
 
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
    and registers the corresponding interrupt. */
 void
 timer_init (void)
 {
+  int i, j;
+
+  for (i = 0; i < ROOT_SLOTS; i++)
+    list_init (&wheel_root[i]);
+  for (i = 0; i < LEVEL_CNT; i++)
+    for (j = 0; j < LEVEL_SLOTS; j++)
+      list_init (&wheel_levels[i][j]);
+  intr_register_softirq (SOFTIRQ_TIMER, run_timers);
+
   pit_configure_channel (0, 2, TIMER_FREQ);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
 
+/* Makes the timer tick HZ times per second, which must be
+   between TIMER_FREQ_MIN and TIMER_FREQ_MAX.  May be called
+   before timer_init().  Pending timers keep their expiration
+   tick, so they expire sooner or later in real time than they
+   would have. */
+void
+timer_set_freq (int hz)
+{
+  enum intr_level old_level;
+
+  ASSERT (hz >= TIMER_FREQ_MIN && hz <= TIMER_FREQ_MAX);
+
+  old_level = intr_disable ();
+  loops_per_tick = (uint64_t) loops_per_tick * timer_freq / hz;
+  timer_freq = hz;
+  pit_per_tick = (PIT_HZ + hz / 2) / hz;
+
+  /* If a tickless sleep is in progress, its interrupt restarts
+     periodic ticks at the new rate. */
+  if (nohz_ticks == 0)
+    pit_configure_channel (0, 2, hz);
+  trace_calibrate ();
+  intr_set_level (old_level);
+}
+
+/* Called by the idle thread, with interrupts off, just before it
+   halts the CPU.  If tickless idle is enabled, replaces the
+   periodic timer interrupt by a single interrupt at the next
+   tick that has work to do: the tick of the next pending timer,
+   or the next time the timer wheel cascades, or as far ahead as
+   the PIT's 16-bit counter reaches, whichever comes first. */
+void
+timer_idle_enter (void)
+{
+  unsigned first, max_ticks;
+  int64_t next;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  /* Don't bother if the timer softirq is behind. */
+  if (!timer_tickless || nohz_ticks != 0
+      || (timer_cnt > 0 && wheel_ticks <= ticks))
+    return;
+
+  /* The PIT is partway through the current tick, with FIRST
+     cycles to go. */
+  first = pit_read (NULL);
+  max_ticks = 1 + (UINT16_MAX - first) / pit_per_tick;
+
+  for (next = ticks + 1; next < ticks + max_ticks; next++)
+    if (timer_cnt > 0
+        && (next % ROOT_SLOTS == 0
+            || !list_empty (&wheel_root[next % ROOT_SLOTS])))
+      break;
+  if (next == ticks + 1)
+    return;
+
+  nohz_ticks = next - ticks;
+  nohz_sleeps++;
+  pit_oneshot (first + (nohz_ticks - 1) * pit_per_tick);
+}
+
+/* Called at the start of every external interrupt.  If the
+   interrupt cut a tickless sleep short, brings the tick count up
+   to date and rearms the PIT for the next tick boundary, after
+   which periodic ticks resume. */
+void
+timer_irq_enter (void)
+{
+  unsigned left;
+  bool expired;
+  int passed;
+
+  if (nohz_ticks <= 1)
+    return;
+
+  /* If the count ran out, this is the timer interrupt, or it
+     is about to arrive, and it accounts for the whole sleep. */
+  left = pit_read (&expired);
+  if (expired)
+    return;
+
+  /* Ticks fall every pit_per_tick cycles back from the end of the
+     count.  Count the ones already passed. */
+  passed = nohz_ticks - 1 - left / pit_per_tick;
+  left %= pit_per_tick;
+  if (left == 0)
+    {
+      passed++;
+      left = pit_per_tick;
+    }
+  nohz_ticks = 1;
+  nohz_skipped += passed;
+  pit_oneshot (left);
+  advance_ticks (passed);
+}
+
 /* Calibrates loops_per_tick, used to implement brief delays. */
 void
 timer_calibrate (void)
@@ -84,16 +234,33 @@ timer_elapsed (int64_t then)
   return timer_ticks () - then;
 }
 
+/* Timer function for timer_sleep(): wakes up THREAD_. */
+static void
+wake_sleeper (struct timer *timer UNUSED, void *thread_)
+{
+  thread_unblock (thread_);
+  thread_preempt ();
+}
+
 /* Sleeps for approximately TICKS timer ticks.  Interrupts must
-   be turned on. */
+   be turned on.  The thread blocks until the timer interrupt
+   for the tick TICKS from now wakes it, using no CPU time in
+   between. */
 void
 timer_sleep (int64_t ticks)
 {
-  int64_t start = timer_ticks ();
+  struct timer timer;
+  enum intr_level old_level;
 
   ASSERT (intr_get_level () == INTR_ON);
-  while (timer_elapsed (start) < ticks)
-    thread_yield ();
+  if (ticks <= 0)
+    return;
+
+  timer_setup (&timer, wake_sleeper, thread_current ());
+  old_level = intr_disable ();
+  timer_add (&timer, timer_ticks () + ticks);
+  thread_block ();
+  intr_set_level (old_level);
 }
 
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
@@ -159,19 +326,212 @@ timer_ndelay (int64_t ns)
   real_time_delay (ns, 1000 * 1000 * 1000);
 }
 
+/* Initializes TIMER to call FUNC, passing AUX, when it
+   expires.  TIMER is not yet pending. */
+void
+timer_setup (struct timer *timer, timer_func *func, void *aux)
+{
+  ASSERT (timer != NULL);
+  ASSERT (func != NULL);
+
+  timer->func = func;
+  timer->aux = aux;
+  timer->pending = false;
+}
+
+/* Arranges for TIMER's function to be called at the end of the
+   timer interrupt for tick EXPIRES, or the next tick if EXPIRES
+   has already passed.  If TIMER is already pending, it is moved
+   to EXPIRES.  May be called from interrupt context, including
+   from TIMER's own function. */
+void
+timer_add (struct timer *timer, int64_t expires)
+{
+  enum intr_level old_level = intr_disable ();
+
+  if (timer->pending)
+    list_remove (&timer->elem);
+  else if (timer_cnt++ == 0)
+    {
+      /* The wheel stops turning while it is empty, since no
+         softirq is raised for it.  Bring it up to the current
+         tick, so that run_timers() does not have to step through
+         every tick it missed. */
+      wheel_ticks = ticks + 1;
+    }
+  timer->expires = expires;
+  timer->pending = true;
+  wheel_insert (timer);
+
+  intr_set_level (old_level);
+}
+
+/* Cancels TIMER.  Returns true if it was pending, false if it
+   had already expired or was never added.  After this returns,
+   TIMER's function will not be called unless it is added
+   again. */
+bool
+timer_cancel (struct timer *timer)
+{
+  enum intr_level old_level = intr_disable ();
+  bool was_pending = timer->pending;
+
+  if (was_pending)
+    {
+      list_remove (&timer->elem);
+      timer->pending = false;
+      timer_cnt--;
+    }
+  intr_set_level (old_level);
+  return was_pending;
+}
+
+/* Returns true if TIMER has been added and has not yet expired
+   or been cancelled. */
+bool
+timer_pending (const struct timer *timer)
+{
+  return timer->pending;
+}
+
+/* Puts TIMER in the wheel slot for its expiration time.  Must be
+   called with interrupts off. */
+static void
+wheel_insert (struct timer *timer)
+{
+  int64_t expires = timer->expires;
+  int64_t delta = expires - wheel_ticks;
+  struct list *slot;
+  int level;
+
+  if (delta < 0)
+    {
+      /* Already expired: process it with the next tick. */
+      slot = &wheel_root[wheel_ticks % ROOT_SLOTS];
+    }
+  else if (delta < ROOT_SLOTS)
+    slot = &wheel_root[expires % ROOT_SLOTS];
+  else
+    {
+      int shift = ROOT_BITS;
+
+      if (delta >= (int64_t) 1 << (ROOT_BITS + LEVEL_CNT * LEVEL_BITS))
+        {
+          /* Too far out for the wheel: park it as far out as the
+             wheel reaches, to be cascaded again from there. */
+          expires = wheel_ticks
+                    + ((int64_t) 1 << (ROOT_BITS + LEVEL_CNT * LEVEL_BITS))
+                    - 1;
+          delta = expires - wheel_ticks;
+        }
+      for (level = 0; level < LEVEL_CNT - 1; level++, shift += LEVEL_BITS)
+        if (delta < (int64_t) 1 << (shift + LEVEL_BITS))
+          break;
+      slot = &wheel_levels[level][(expires >> shift) % LEVEL_SLOTS];
+    }
+  list_push_back (slot, &timer->elem);
+}
+
+/* Empties slot INDEX of level LEVEL back into the wheel, and
+   returns INDEX.  Must be called with interrupts off. */
+static int
+cascade (int level, int index)
+{
+  struct list *slot = &wheel_levels[level][index];
+
+  while (!list_empty (slot))
+    wheel_insert (list_entry (list_pop_front (slot), struct timer, elem));
+  return index;
+}
+
+/* Timer softirq: brings the wheel up to the current tick,
+   calling the functions of the timers that expire along the
+   way with interrupts enabled. */
+static void
+run_timers (void)
+{
+  enum intr_level old_level = intr_disable ();
+
+  while (wheel_ticks <= ticks)
+    {
+      struct list *slot = &wheel_root[wheel_ticks % ROOT_SLOTS];
+
+      if (timer_cnt == 0)
+        {
+          /* Nothing to expire or cascade: skip ahead. */
+          wheel_ticks = ticks + 1;
+          break;
+        }
+
+      /* At each wrap of the root, cascade level 0, and so on
+         up for each level that also wraps. */
+      if (wheel_ticks % ROOT_SLOTS == 0)
+        {
+          int level, shift = ROOT_BITS;
+          for (level = 0; level < LEVEL_CNT; level++, shift += LEVEL_BITS)
+            if (cascade (level, (wheel_ticks >> shift) % LEVEL_SLOTS) != 0)
+              break;
+        }
+      wheel_ticks++;
+
+      while (!list_empty (slot))
+        {
+          struct timer *timer = list_entry (list_pop_front (slot),
+                                            struct timer, elem);
+          timer->pending = false;
+          timer_cnt--;
+
+          intr_set_level (old_level);
+          timer->func (timer, timer->aux);
+          intr_disable ();
+        }
+    }
+  intr_set_level (old_level);
+}
+
 /* Prints timer statistics. */
 void
 timer_print_stats (void)
 {
   printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+  if (timer_tickless)
+    printf ("Timer: %"PRId64" ticks skipped in %"PRId64" tickless sleeps\n",
+            nohz_skipped, nohz_sleeps);
+}
+
+/* Advances the tick count by CNT ticks, as if CNT timer
+   interrupts had occurred.  Must be called in interrupt
+   context. */
+static void
+advance_ticks (int cnt)
+{
+  while (cnt-- > 0)
+    {
+      ticks++;
+      thread_tick ();
+    }
+
+  /* Leave the timer wheel to the softirq, which runs once the
+     PIC has been acknowledged. */
+  if (timer_cnt > 0)
+    intr_raise_softirq (SOFTIRQ_TIMER);
 }
 
 /* Timer interrupt handler. */
 static void
 timer_interrupt (struct intr_frame *args UNUSED)
 {
-  ticks++;
-  thread_tick ();
+  int cnt = 1;
+
+  if (nohz_ticks > 0)
+    {
+      /* End of a tickless sleep. */
+      cnt = nohz_ticks;
+      nohz_ticks = 0;
+      nohz_skipped += cnt - 1;
+      pit_configure_channel (0, 2, TIMER_FREQ);
+    }
+  advance_ticks (cnt);
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -1,14 +1,31 @@
 #ifndef DEVICES_TIMER_H
 #define DEVICES_TIMER_H
 
+#include <list.h>
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
-/* Number of timer interrupts per second. */
-#define TIMER_FREQ 100
+/* Number of timer ticks per second.  TIMER_FREQ_DEFAULT unless
+   changed with timer_set_freq(), e.g. by the "-hz" kernel
+   option. */
+#define TIMER_FREQ timer_freq
+#define TIMER_FREQ_DEFAULT 100
+#define TIMER_FREQ_MIN 19       /* The 8254 can't go slower. */
+#define TIMER_FREQ_MAX 1000
+extern int timer_freq;
+
+/* If true, the idle thread stops the periodic timer interrupt
+   until the next pending timer.  Set by the "-tickless" kernel
+   option. */
+extern bool timer_tickless;
 
 void timer_init (void);
 void timer_calibrate (void);
+void timer_set_freq (int hz);
+
+void timer_idle_enter (void);
+void timer_irq_enter (void);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
@@ -26,4 +43,32 @@ void timer_ndelay (int64_t nanoseconds);
 
 void timer_print_stats (void);
 
+/* Kernel timers.
+
+   A timer calls a function once timer_ticks() reaches a given
+   tick.  The function runs in softirq context (see
+   threads/interrupt.h) at the end of the timer interrupt for
+   that tick: it may not sleep, but it may wake threads, and it
+   may add its timer again to run periodically.  The owner keeps
+   the struct timer alive while it is pending.
+
+   Adding, cancelling and expiring a timer each take constant
+   time, however many timers are pending. */
+struct timer;
+typedef void timer_func (struct timer *, void *aux);
+
+struct timer
+  {
+    struct list_elem elem;      /* Element in a timer wheel slot. */
+    int64_t expires;            /* Tick at which to call FUNC. */
+    timer_func *func;           /* Function to call. */
+    void *aux;                  /* Auxiliary data for FUNC. */
+    bool pending;               /* Added and not yet expired or cancelled? */
+  };
+
+void timer_setup (struct timer *, timer_func *, void *aux);
+void timer_add (struct timer *, int64_t expires);
+bool timer_cancel (struct timer *);
+bool timer_pending (const struct timer *);
+
 #endif /* devices/timer.h */
@@ -14,16 +14,20 @@
 #include "threads/malloc.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
-#include "threads/vaddr.h"
-
-#include "userprog/pagedir.h"
-#include "userprog/process.h"
-#include "devices/shutdown.h"
+#include "threads/workqueue.h"
 
 
 static struct cache_entry cache[64]; /* static cache array */
 struct semaphore global_cache_sema; /* guard semaphore for the cache */
 
+/* Dirty blocks are also written back every CACHE_FLUSH_SECS
+   seconds by a worker thread, so that a crash loses less data. */
+#define CACHE_FLUSH_SECS 30
+static struct delayed_work flush_work;
+static bool flush_stopped; /* set by cache_done() */
+
+static void cache_flush_work (struct work *, void *);
+
 /* Finds index if sector is in cache, if not return -1. */
 int
 find_entry(block_sector_t sector) 
@@ -76,13 +80,18 @@ cache_init (void)
 	int i = 0;
 	while (i < 64)
 	{
-		sema_init(&cache[i].cache_entry_sema, 1);
+		rwlock_init(&cache[i].cache_entry_lock);
 		cache[i].sector = 8388609; // 2^23+1
 		cache[i].data = (char *) malloc(BLOCK_SECTOR_SIZE);
 		cache[i].last_use_time = 0; 
 		cache[i].dirty_bit = 0;
 		i++;
 	}
+
+	/* Start the periodic flusher */
+	flush_stopped = false;
+	delayed_work_init (&flush_work, cache_flush_work, NULL);
+	work_queue_delayed (&flush_work, CACHE_FLUSH_SECS * TIMER_FREQ);
 }
 
 /* Reads from a sector--brings into the cache if not already present. */
@@ -107,12 +116,12 @@ cache_read_block (block_sector_t sector, void *buffer_)
 	}
 	sema_up(&global_cache_sema);
 
-	/*  try to acquire that block */
-	sema_down(&cache[entry_index].cache_entry_sema);
+	/*  try to acquire that block; readers share it */
+	rwlock_acquire_read(&cache[entry_index].cache_entry_lock);
 
 	memcpy(buffer,cache[entry_index].data,BLOCK_SECTOR_SIZE); // copy data 
 	cache[entry_index].last_use_time = timer_ticks (); // update recently used
-	sema_up(&cache[entry_index].cache_entry_sema);
+	rwlock_release_read(&cache[entry_index].cache_entry_lock);
 
 	return true;
 }
@@ -138,11 +147,11 @@ cache_write_block (block_sector_t sector, void *buffer_)
 	sema_up(&global_cache_sema);
 
 	/*  try to acquire that block */
-	sema_down(&cache[entry_index].cache_entry_sema);
+	rwlock_acquire_write(&cache[entry_index].cache_entry_lock);
 	memcpy(cache[entry_index].data, buffer_, BLOCK_SECTOR_SIZE); // write to data 
 	cache[entry_index].last_use_time = timer_ticks (); // update recently used
 	cache[entry_index].dirty_bit = 1; // set dirty bit
-	sema_up(&cache[entry_index].cache_entry_sema);
+	rwlock_release_write(&cache[entry_index].cache_entry_lock);
 
 	return true;
 }
@@ -163,7 +172,7 @@ cache_add_block (block_sector_t sector)
 		return entry_exists;
 	}
 
-	sema_down(&cache[index].cache_entry_sema);
+	rwlock_acquire_write(&cache[index].cache_entry_lock);
 
 	// if entry is dirty write-back
 	if(cache[index].dirty_bit == 1)
@@ -178,15 +187,64 @@ cache_add_block (block_sector_t sector)
 	cache[index].last_use_time = timer_ticks ();
 	cache[index].dirty_bit = 0;
 
-	sema_up(&cache[index].cache_entry_sema);
+	rwlock_release_write(&cache[index].cache_entry_lock);
 
 	return index;
 }
 
+/* Writes every dirty block back to disk, leaving it cached */
+void
+cache_flush (void)
+{
+	int i = 0;
+	while (i < 64)
+	{
+		if (cache[i].dirty_bit == 1)
+		{
+			/* recheck under the lock, cache_add_block() may have
+			written it back and replaced it meanwhile */
+			rwlock_acquire_write(&cache[i].cache_entry_lock);
+			if (cache[i].dirty_bit == 1)
+			{
+				block_write (fs_device, cache[i].sector, cache[i].data);
+				cache[i].dirty_bit = 0;
+			}
+			rwlock_release_write(&cache[i].cache_entry_lock);
+		}
+		i++;
+	}
+}
+
+/* Work function for the periodic flusher */
+static void
+cache_flush_work (struct work *work UNUSED, void *aux UNUSED)
+{
+	enum intr_level old_level;
+
+	cache_flush ();
+
+	/* check and re-arm in one step, so cache_done() can't set
+	flush_stopped in between */
+	old_level = intr_disable ();
+	if (!flush_stopped)
+		work_queue_delayed (&flush_work, CACHE_FLUSH_SECS * TIMER_FREQ);
+	intr_set_level (old_level);
+}
+
 /* Free cache's allocated memory and delete the data */
 void
 cache_done (void)
 {
+	/* stop the flusher and wait for it if it is running, then
+	cancel again in case it re-armed itself before it saw
+	flush_stopped */
+	enum intr_level old_level = intr_disable ();
+	flush_stopped = true;
+	intr_set_level (old_level);
+	work_cancel_delayed (&flush_work);
+	workqueue_flush ();
+	work_cancel_delayed (&flush_work);
+
 	int i = 0;
 	while (i < 64)
 	{
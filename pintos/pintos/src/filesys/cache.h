@@ -16,7 +16,7 @@ struct cache_entry
 {
 	block_sector_t sector;  // sector of cache entry
 	char *data;							// data in sector
-	struct semaphore cache_entry_sema;  // semaphore for r/w operations
+	struct rwlock cache_entry_lock;  // shared for reads, exclusive for writes
 	int64_t last_use_time;  // used for LRU search
 	bool dirty_bit;				  // used for write-back
 };
@@ -26,6 +26,7 @@ void cache_init (void);
 bool cache_read_block (block_sector_t sector, void *buffer_);
 bool cache_write_block (block_sector_t sector, void *buffer_);
 int cache_add_block (block_sector_t sector);
+void cache_flush (void);
 void cache_done (void);
 
 /* helpers */
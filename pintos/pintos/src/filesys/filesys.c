@@ -12,6 +12,9 @@
 /* Partition that contains the file system. */
 struct block *fs_device;
 
+/* Set once filesys_init() has run. */
+bool init_filesys;
+
 static void do_format (void);
 
 /* Initializes the file system module.
@@ -149,6 +152,10 @@ filesys_remove (const char *name)
   if (!path_finder_result || !dir_lookup(dir, filename, &ref_inode))
     return false;
 
+  /* dir_remove() opens the inode itself; holding this reference
+     would keep the inode open, and its blocks allocated, forever. */
+  inode_close (ref_inode);
+
   /* This means that we found a directory, we'll need to get the parent */
   if (strcmp(filename, ".") == 0) {
 
@@ -302,6 +309,9 @@ path_finder (const char *path, struct dir **desired_dir, char filename[NAME_MAX
 
       /* found a file or didn't find anything */
       } else {
+          /* callers look the file up again by name */
+          if (dir_lookup_result)
+            inode_close (next_ref_inode);
 
           /* ensuring that this is the end of the path */
           if ((get_next_part (part, &path)) == 1) {
@@ -9,7 +9,8 @@
 #define FREE_MAP_SECTOR 0       /* Free map file inode sector. */
 #define ROOT_DIR_SECTOR 1       /* Root directory file inode sector. */
 
-static bool init_filesys = false;
+/* Set once filesys_init() has run. */
+extern bool init_filesys;
 
 /* Block device that contains the file system. */
 struct block *fs_device;
@@ -51,6 +51,19 @@ free_map_allocate (size_t cnt, block_sector_t *sectorp)
   return sector != BITMAP_ERROR;
 }
 
+/* Allocates a run of up to CNT consecutive sectors, trying CNT,
+   then half as many, and so on, and stores the first into
+   *SECTORP.  Returns the number of sectors allocated, or 0 if
+   the disk is full. */
+size_t
+free_map_allocate_run (size_t cnt, block_sector_t *sectorp)
+{
+  for (; cnt > 0; cnt /= 2)
+    if (free_map_allocate (cnt, sectorp))
+      return cnt;
+  return 0;
+}
+
 /* Makes CNT sectors starting at SECTOR available for use. */
 void
 free_map_release (block_sector_t sector, size_t cnt)
@@ -0,0 +1,191 @@
+/* A block layer for the host harness with a single device, the
+   file system, backed by a disk image file.  Keeps the same
+   statistics as devices/block.c so that results from the harness
+   and from Pintos can be compared directly. */
+
+#include "devices/block.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/cpu.h"
+#include "filesys/host/block-file.h"
+#include "filesys/host/hostio.h"
+
+/* The image-backed file system device. */
+struct block
+  {
+    char name[16];                      /* Name, for messages. */
+    int fd;                             /* Host file descriptor. */
+    block_sector_t size;                /* Size in sectors. */
+    struct block_stats stats;           /* Statistics. */
+    block_sector_t next_sector;         /* Sector after last request. */
+  };
+
+static struct block filesys_block;
+static bool filesys_open;
+
+/* Opens the disk image NAME as the file system device.  If
+   CREATE_SECTORS is nonzero, the image is created or truncated
+   to that many sectors first. */
+void
+block_file_open (const char *name, block_sector_t create_sectors)
+{
+  struct block *block = &filesys_block;
+  unsigned long long bytes;
+
+  ASSERT (!filesys_open);
+  block->fd = hostio_open (name,
+                           (unsigned long long) create_sectors
+                           * BLOCK_SECTOR_SIZE, &bytes);
+  block->size = bytes / BLOCK_SECTOR_SIZE;
+  if (block->size == 0)
+    PANIC ("%s: image smaller than one sector", name);
+  strlcpy (block->name, "hdb1", sizeof block->name);
+  memset (&block->stats, 0, sizeof block->stats);
+  block->next_sector = 0;
+  filesys_open = true;
+}
+
+/* Closes the file system device. */
+void
+block_file_close (void)
+{
+  ASSERT (filesys_open);
+  hostio_close (filesys_block.fd);
+  filesys_open = false;
+}
+
+/* Discards the statistics gathered so far. */
+void
+block_file_reset_stats (void)
+{
+  memset (&filesys_block.stats, 0, sizeof filesys_block.stats);
+}
+
+/* Returns the file system device, or a null pointer for any
+   other ROLE. */
+struct block *
+block_get_role (enum block_type role)
+{
+  return role == BLOCK_FILESYS && filesys_open ? &filesys_block : NULL;
+}
+
+block_sector_t
+block_size (struct block *block)
+{
+  return block->size;
+}
+
+const char *
+block_name (struct block *block)
+{
+  return block->name;
+}
+
+enum block_type
+block_type (struct block *block UNUSED)
+{
+  return BLOCK_FILESYS;
+}
+
+/* Returns the histogram bucket for a request of CYCLES. */
+static unsigned
+latency_bucket (uint64_t cycles)
+{
+  unsigned bucket = 0;
+
+  while (cycles > 1 && bucket < BLOCK_LATENCY_BUCKETS - 1)
+    {
+      cycles >>= 1;
+      bucket++;
+    }
+  return bucket;
+}
+
+/* Accounts for a request for SECTOR on BLOCK that started at
+   cycle START. */
+static void
+account (struct block *block, block_sector_t sector, bool write,
+         uint64_t start)
+{
+  struct block_stats *s = &block->stats;
+  uint64_t cycles = rdtsc () - start;
+
+  if (sector == block->next_sector)
+    s->seq_cnt++;
+  else
+    s->random_cnt++;
+  block->next_sector = sector + 1;
+  s->depth_sum++;
+  s->max_depth = 1;
+
+  if (write)
+    {
+      s->write_cnt++;
+      s->bytes_written += BLOCK_SECTOR_SIZE;
+      s->write_cycles += cycles;
+      s->write_latency[latency_bucket (cycles)]++;
+    }
+  else
+    {
+      s->read_cnt++;
+      s->bytes_read += BLOCK_SECTOR_SIZE;
+      s->read_cycles += cycles;
+      s->read_latency[latency_bucket (cycles)]++;
+    }
+}
+
+static void
+check_sector (struct block *block, block_sector_t sector)
+{
+  if (sector >= block->size)
+    PANIC ("Access past end of device %s (sector=%"PRDSNu", "
+           "size=%"PRDSNu")\n", block->name, sector, block->size);
+}
+
+void
+block_read (struct block *block, block_sector_t sector, void *buffer)
+{
+  uint64_t start;
+
+  check_sector (block, sector);
+  start = rdtsc ();
+  hostio_read (block->fd, (unsigned long long) sector * BLOCK_SECTOR_SIZE,
+               buffer, BLOCK_SECTOR_SIZE);
+  account (block, sector, false, start);
+}
+
+void
+block_write (struct block *block, block_sector_t sector, const void *buffer)
+{
+  uint64_t start;
+
+  check_sector (block, sector);
+  start = rdtsc ();
+  hostio_write (block->fd, (unsigned long long) sector * BLOCK_SECTOR_SIZE,
+                buffer, BLOCK_SECTOR_SIZE);
+  account (block, sector, true, start);
+}
+
+void
+block_get_stats (struct block *block, struct block_stats *stats)
+{
+  *stats = block->stats;
+}
+
+unsigned long long
+get_write_cnt (void)
+{
+  return filesys_block.stats.write_cnt;
+}
+
+void
+block_print_stats (void)
+{
+  const struct block_stats *s = &filesys_block.stats;
+
+  printf ("%s (%s): %llu reads, %llu writes\n",
+          filesys_block.name, "filesys", s->read_cnt, s->write_cnt);
+  printf ("%s: %llu sequential, %llu random\n",
+          filesys_block.name, s->seq_cnt, s->random_cnt);
+}
@@ -0,0 +1,10 @@
+#ifndef FILESYS_HOST_BLOCK_FILE_H
+#define FILESYS_HOST_BLOCK_FILE_H
+
+#include "devices/block.h"
+
+void block_file_open (const char *name, block_sector_t create_sectors);
+void block_file_close (void);
+void block_file_reset_stats (void);
+
+#endif /* filesys/host/block-file.h */
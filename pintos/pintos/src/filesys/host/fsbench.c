@@ -0,0 +1,375 @@
+/* fsbench: runs the Pintos file system as an ordinary Linux
+   process on top of a disk image, so that its performance can be
+   measured and profiled with host tools (perf, gprof, valgrind)
+   without booting a simulator.
+
+   Usage: fsbench [-f] [-s SECTORS] [-n COUNT] [-r SEED]
+                  IMAGE WORKLOAD...
+
+   The workloads replay tests from tests/filesys:
+
+     seq-block   Writes a COUNT-byte file sequentially in 513-byte
+                 chunks, then reads it back (base/lg-seq-block).
+     seq-prealloc
+                 Same as seq-block, but reserves the file's space
+                 with inode_reserve() (fallocate) first.
+     random      Writes, then reads, the 512-byte blocks of a
+                 COUNT-byte file in random order (base/lg-random).
+     grow-dir    Creates COUNT 512-byte files in a new directory
+                 and reads each one back (extended/grow-dir-lg).
+
+   Each workload prints one line of "key=value" fields giving its
+   elapsed time, throughput, and buffer cache and device
+   activity. */
+
+#include <debug.h>
+#include <random.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "filesys/cache.h"
+#include "filesys/directory.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "filesys/inode.h"
+#include "filesys/host/block-file.h"
+#include "filesys/host/hostio.h"
+#include "threads/malloc.h"
+
+/* Default image size for -f, in sectors (4 MB). */
+#define DEFAULT_SECTORS 8192
+
+/* Default COUNT for each workload, matching the "lg" tests. */
+#define SEQ_BLOCK_SIZE 513
+#define SEQ_DEFAULT_BYTES 75678
+#define RANDOM_BLOCK_SIZE 512
+#define RANDOM_DEFAULT_BYTES (512 * 150)
+#define GROW_DIR_FILE_SIZE 512
+#define GROW_DIR_DEFAULT_FILES 50
+
+/* Options. */
+static unsigned long count;             /* -n: workload size, 0=default. */
+
+/* Results of running one workload. */
+struct result
+  {
+    unsigned long long bytes;           /* Bytes read plus written. */
+    unsigned long long ops;             /* Operations performed. */
+  };
+
+static void usage (void) NO_RETURN;
+
+/* Fails with a message. */
+static void fail (const char *format, ...) PRINTF_FORMAT (1, 2) NO_RETURN;
+
+static void
+fail (const char *format, ...)
+{
+  va_list args;
+
+  printf ("fsbench: ");
+  va_start (args, format);
+  vprintf (format, args);
+  va_end (args);
+  printf ("\n");
+  hostio_exit (1);
+}
+
+/* Opens NAME, which may be a path, the same way as the open
+   system call. */
+static struct file *
+open_file (const char *name)
+{
+  struct inode *inode = filesys_open_inode (name);
+  struct file *file = inode != NULL ? file_open (inode) : NULL;
+
+  if (file == NULL)
+    fail ("open \"%s\" failed", name);
+  return file;
+}
+
+/* Creates NAME with INITIAL_SIZE and opens it. */
+static struct file *
+create_and_open (const char *name, off_t initial_size)
+{
+  if (!filesys_create (name, initial_size))
+    fail ("create \"%s\" failed (image not freshly formatted?)", name);
+  return open_file (name);
+}
+
+/* Reads SIZE bytes at OFS in FILE and compares them with
+   EXPECTED. */
+static void
+check_read (struct file *file, const char *name, const char *expected,
+            size_t size, off_t ofs)
+{
+  char block[SEQ_BLOCK_SIZE];
+
+  ASSERT (size <= sizeof block);
+  if (file_read_at (file, block, size, ofs) != (off_t) size)
+    fail ("read %zu bytes at offset %d in \"%s\" failed",
+          size, (int) ofs, name);
+  if (memcmp (block, expected, size))
+    fail ("\"%s\" differs from expected at offset %d", name, (int) ofs);
+}
+
+/* Allocates and fills a buffer of SIZE random bytes. */
+static char *
+random_buffer (size_t size)
+{
+  char *buf = malloc (size);
+  if (buf == NULL)
+    fail ("out of memory");
+  random_bytes (buf, size);
+  return buf;
+}
+
+/* Writes a file sequentially, then reads it back.  If PREALLOC,
+   reserves the file's space up front. */
+static void
+seq_write_read (struct result *r, const char *name, bool prealloc)
+{
+  size_t size = count ? count : SEQ_DEFAULT_BYTES;
+  char *buf = random_buffer (size);
+  struct file *file = create_and_open (name, 0);
+  size_t ofs;
+
+  if (prealloc && !inode_reserve (file_get_inode (file), size))
+    fail ("reserving %zu bytes for \"%s\" failed", size, name);
+
+  for (ofs = 0; ofs < size; ofs += SEQ_BLOCK_SIZE)
+    {
+      size_t block_size = size - ofs < SEQ_BLOCK_SIZE
+                          ? size - ofs : SEQ_BLOCK_SIZE;
+      if (file_write (file, buf + ofs, block_size) != (off_t) block_size)
+        fail ("write %zu bytes at offset %zu in \"%s\" failed",
+              block_size, ofs, name);
+      r->ops++;
+    }
+  for (ofs = 0; ofs < size; ofs += SEQ_BLOCK_SIZE)
+    {
+      size_t block_size = size - ofs < SEQ_BLOCK_SIZE
+                          ? size - ofs : SEQ_BLOCK_SIZE;
+      check_read (file, name, buf + ofs, block_size, ofs);
+      r->ops++;
+    }
+  r->bytes = 2 * (unsigned long long) size;
+
+  file_close (file);
+  free (buf);
+}
+
+static void
+seq_block (struct result *r)
+{
+  seq_write_read (r, "noodle", false);
+}
+
+static void
+seq_prealloc (struct result *r)
+{
+  seq_write_read (r, "prealloc", true);
+}
+
+/* Shuffles the CNT elements of ORDER, like tests/lib.c's
+   shuffle(). */
+static void
+shuffle (size_t *order, size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    {
+      size_t j = i + random_ulong () % (cnt - i);
+      size_t t = order[i];
+      order[i] = order[j];
+      order[j] = t;
+    }
+}
+
+/* Writes the blocks of a file in random order, then reads them
+   back in another random order. */
+static void
+random_blocks (struct result *r)
+{
+  const char *name = "bazzle";
+  size_t block_cnt = (count ? count : RANDOM_DEFAULT_BYTES)
+                     / RANDOM_BLOCK_SIZE;
+  size_t size = block_cnt * RANDOM_BLOCK_SIZE;
+  char *buf = random_buffer (size);
+  size_t *order = malloc (block_cnt * sizeof *order);
+  struct file *file;
+  size_t i;
+
+  if (order == NULL)
+    fail ("out of memory");
+  file = create_and_open (name, size);
+
+  for (i = 0; i < block_cnt; i++)
+    order[i] = i;
+  shuffle (order, block_cnt);
+  for (i = 0; i < block_cnt; i++)
+    {
+      off_t ofs = order[i] * RANDOM_BLOCK_SIZE;
+      if (file_write_at (file, buf + ofs, RANDOM_BLOCK_SIZE, ofs)
+          != RANDOM_BLOCK_SIZE)
+        fail ("write %d bytes at offset %d failed",
+              RANDOM_BLOCK_SIZE, (int) ofs);
+    }
+  shuffle (order, block_cnt);
+  for (i = 0; i < block_cnt; i++)
+    {
+      off_t ofs = order[i] * RANDOM_BLOCK_SIZE;
+      check_read (file, name, buf + ofs, RANDOM_BLOCK_SIZE, ofs);
+    }
+  r->ops = 2 * block_cnt;
+  r->bytes = 2 * (unsigned long long) size;
+
+  file_close (file);
+  free (order);
+  free (buf);
+}
+
+/* Creates files in a new directory, one at a time, and reads
+   each one back. */
+static void
+grow_dir (struct result *r)
+{
+  size_t file_cnt = count ? count : GROW_DIR_DEFAULT_FILES;
+  char buf[GROW_DIR_FILE_SIZE];
+  size_t i;
+
+  if (!dir_allocate ("/x", 32))
+    fail ("mkdir \"/x\" failed (image not freshly formatted?)");
+  for (i = 0; i < file_cnt; i++)
+    {
+      char name[128];
+      struct file *file;
+
+      snprintf (name, sizeof name, "/x/file%zu", i);
+      random_bytes (buf, sizeof buf);
+      file = create_and_open (name, 0);
+      if (file_write (file, buf, sizeof buf) != sizeof buf)
+        fail ("write %zu bytes to \"%s\" failed", sizeof buf, name);
+      file_close (file);
+
+      file = open_file (name);
+      check_read (file, name, buf, sizeof buf, 0);
+      file_close (file);
+    }
+  r->ops = file_cnt;
+  r->bytes = 2 * (unsigned long long) file_cnt * sizeof buf;
+}
+
+/* A workload. */
+struct workload
+  {
+    const char *name;
+    void (*run) (struct result *);
+  };
+
+static const struct workload workloads[] =
+  {
+    {"seq-block", seq_block},
+    {"seq-prealloc", seq_prealloc},
+    {"random", random_blocks},
+    {"grow-dir", grow_dir},
+  };
+
+#define WORKLOAD_CNT (sizeof workloads / sizeof *workloads)
+
+/* Runs workload W and prints its results. */
+static void
+run_workload (const struct workload *w)
+{
+  struct result r = {0, 0};
+  struct block_stats stats;
+  unsigned long long start, usecs;
+  int calls, misses;
+
+  block_file_reset_stats ();
+  cache_calls = cache_miss = 0;
+
+  start = hostio_usecs ();
+  w->run (&r);
+  usecs = hostio_usecs () - start;
+  if (usecs == 0)
+    usecs = 1;
+
+  calls = cache_calls;
+  misses = cache_miss;
+  block_get_stats (block_get_role (BLOCK_FILESYS), &stats);
+  printf ("%s: usecs=%llu bytes=%llu ops=%llu kb_per_sec=%llu "
+          "ops_per_sec=%llu cache_calls=%d cache_misses=%d "
+          "dev_reads=%llu dev_writes=%llu\n",
+          w->name, usecs, r.bytes, r.ops,
+          r.bytes * 1000000 / 1024 / usecs, r.ops * 1000000 / usecs,
+          calls, misses, stats.read_cnt, stats.write_cnt);
+}
+
+static void
+usage (void)
+{
+  size_t i;
+
+  printf ("usage: fsbench [-f] [-s SECTORS] [-n COUNT] [-r SEED] "
+          "IMAGE WORKLOAD...\n"
+          "  -f          create IMAGE and format it first\n"
+          "  -s SECTORS  size of the image created by -f (default %d)\n"
+          "  -n COUNT    bytes (seq-*, random) or files (grow-dir)\n"
+          "  -r SEED     random seed (default 57)\n"
+          "workloads:", DEFAULT_SECTORS);
+  for (i = 0; i < WORKLOAD_CNT; i++)
+    printf (" %s", workloads[i].name);
+  printf ("\n");
+  hostio_exit (1);
+}
+
+int
+main (int argc, char *argv[])
+{
+  bool format = false;
+  block_sector_t sectors = DEFAULT_SECTORS;
+  unsigned seed = 57;
+  int i;
+
+  for (i = 1; i < argc && argv[i][0] == '-'; i++)
+    {
+      const char *opt = argv[i];
+
+      if (!strcmp (opt, "-f"))
+        format = true;
+      else if (i + 1 >= argc)
+        usage ();
+      else if (!strcmp (opt, "-s"))
+        sectors = atoi (argv[++i]);
+      else if (!strcmp (opt, "-n"))
+        count = atoi (argv[++i]);
+      else if (!strcmp (opt, "-r"))
+        seed = atoi (argv[++i]);
+      else
+        usage ();
+    }
+  if (argc - i < 2)
+    usage ();
+
+  block_file_open (argv[i++], format ? sectors : 0);
+  random_init (seed);
+  filesys_init (format);
+
+  for (; i < argc; i++)
+    {
+      size_t j;
+
+      for (j = 0; j < WORKLOAD_CNT; j++)
+        if (!strcmp (argv[i], workloads[j].name))
+          break;
+      if (j >= WORKLOAD_CNT)
+        fail ("unknown workload \"%s\"", argv[i]);
+      run_workload (&workloads[j]);
+    }
+
+  filesys_done ();
+  block_file_close ();
+  return 0;
+}
@@ -0,0 +1,85 @@
+/* Host side of the file system harness.  Compiled against the
+   Linux C library, unlike the rest of the harness; see
+   hostio.h. */
+
+#include "hostio.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Prints MESSAGE and the current errno, then exits. */
+static void
+fail (const char *message)
+{
+  fprintf (stderr, "fsbench: %s: %s\n", message, strerror (errno));
+  exit (EXIT_FAILURE);
+}
+
+/* Opens disk image NAME for reading and writing and stores its
+   size in bytes into *SIZE.  If CREATE_SIZE is nonzero, the image
+   is created (or truncated) to CREATE_SIZE bytes first.  Returns
+   the file descriptor. */
+int
+hostio_open (const char *name, unsigned long long create_size,
+             unsigned long long *size)
+{
+  struct stat st;
+  int fd;
+
+  fd = open (name, O_RDWR | (create_size ? O_CREAT | O_TRUNC : 0), 0666);
+  if (fd < 0)
+    fail (name);
+  if (create_size && ftruncate (fd, create_size) < 0)
+    fail (name);
+  if (fstat (fd, &st) < 0)
+    fail (name);
+  *size = st.st_size;
+  return fd;
+}
+
+/* Reads LEN bytes at offset OFS in FD into BUF. */
+void
+hostio_read (int fd, unsigned long long ofs, void *buf, unsigned len)
+{
+  if (pread (fd, buf, len, ofs) != (ssize_t) len)
+    fail ("disk image read");
+}
+
+/* Writes LEN bytes from BUF at offset OFS in FD. */
+void
+hostio_write (int fd, unsigned long long ofs, const void *buf, unsigned len)
+{
+  if (pwrite (fd, buf, len, ofs) != (ssize_t) len)
+    fail ("disk image write");
+}
+
+/* Closes FD. */
+void
+hostio_close (int fd)
+{
+  if (close (fd) < 0)
+    fail ("disk image close");
+}
+
+/* Returns a monotonic timestamp in microseconds. */
+unsigned long long
+hostio_usecs (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+/* Flushes standard output and exits with STATUS. */
+void
+hostio_exit (int status)
+{
+  fflush (stdout);
+  exit (status);
+}
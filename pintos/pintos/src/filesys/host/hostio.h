@@ -0,0 +1,20 @@
+#ifndef FILESYS_HOST_HOSTIO_H
+#define FILESYS_HOST_HOSTIO_H
+
+/* Thin wrappers around the Linux system calls that the host
+   harness needs.  hostio.c is the only file in the harness
+   compiled against the host's C library headers; everything else
+   is compiled against the Pintos headers, so the interface here
+   sticks to basic C types that mean the same thing in both. */
+
+int hostio_open (const char *name, unsigned long long create_size,
+                 unsigned long long *size);
+void hostio_read (int fd, unsigned long long ofs, void *buf, unsigned len);
+void hostio_write (int fd, unsigned long long ofs, const void *buf,
+                   unsigned len);
+void hostio_close (int fd);
+
+unsigned long long hostio_usecs (void);
+void hostio_exit (int status) __attribute__ ((noreturn));
+
+#endif /* filesys/host/hostio.h */
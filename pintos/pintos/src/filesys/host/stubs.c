@@ -0,0 +1,294 @@
+/* Single-threaded stand-ins for the kernel services that the
+   file system code uses, so that it can run as a Linux process.
+   There is only ever one thread, so a semaphore that would block
+   indicates a deadlock and panics. */
+
+#include <debug.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "filesys/host/hostio.h"
+
+/* The one and only thread. */
+static struct thread host_thread;
+
+/* Returns the running thread. */
+struct thread *
+thread_current (void)
+{
+  if (host_thread.status != THREAD_RUNNING)
+    {
+      strlcpy (host_thread.name, "fsbench", sizeof host_thread.name);
+      host_thread.status = THREAD_RUNNING;
+      host_thread.tid = 1;
+      host_thread.priority = PRI_DEFAULT;
+      list_init (&host_thread.children);
+      list_init (&host_thread.file_data_list);
+    }
+  return &host_thread;
+}
+
+/* Returns the running thread's name. */
+const char *
+thread_name (void)
+{
+  return thread_current ()->name;
+}
+
+/* Returns the running thread's tid. */
+tid_t
+thread_tid (void)
+{
+  return thread_current ()->tid;
+}
+
+/* Returns the running thread's working directory. */
+struct dir *
+thread_get_dir (void)
+{
+  return thread_current ()->curr_dir;
+}
+
+/* Counts calls instead of timer interrupts, which is all the
+   buffer cache needs for its LRU ordering. */
+int64_t
+timer_ticks (void)
+{
+  static int64_t ticks;
+  return ++ticks;
+}
+
+/* Returns the number of "ticks" elapsed since THEN. */
+int64_t
+timer_elapsed (int64_t then)
+{
+  return timer_ticks () - then;
+}
+
+int timer_freq = TIMER_FREQ_DEFAULT;
+
+/* There are no interrupts to turn off. */
+enum intr_level
+intr_disable (void)
+{
+  return INTR_OFF;
+}
+
+enum intr_level
+intr_set_level (enum intr_level level)
+{
+  return level;
+}
+
+/* There are no worker threads or timer interrupts, so delayed
+   work never runs: the buffer cache's periodic flusher is
+   inert, and dirty blocks are written back by eviction and
+   cache_done(). */
+void
+delayed_work_init (struct delayed_work *dw, work_func *func, void *aux)
+{
+  dw->work.func = func;
+  dw->work.aux = aux;
+  dw->work.pending = false;
+}
+
+bool
+work_queue_delayed (struct delayed_work *dw UNUSED, int64_t ticks UNUSED)
+{
+  return true;
+}
+
+bool
+work_cancel_delayed (struct delayed_work *dw UNUSED)
+{
+  return false;
+}
+
+void
+workqueue_flush (void)
+{
+}
+
+void
+sema_init (struct semaphore *sema, unsigned value)
+{
+  ASSERT (sema != NULL);
+  sema->value = value;
+  list_init (&sema->waiters);
+}
+
+void
+sema_down (struct semaphore *sema)
+{
+  if (sema->value == 0)
+    PANIC ("sema_down would block forever in a single thread");
+  sema->value--;
+}
+
+bool
+sema_try_down (struct semaphore *sema)
+{
+  if (sema->value == 0)
+    return false;
+  sema->value--;
+  return true;
+}
+
+void
+sema_up (struct semaphore *sema)
+{
+  sema->value++;
+}
+
+void
+lock_init (struct lock *lock)
+{
+  lock->holder = NULL;
+  sema_init (&lock->semaphore, 1);
+}
+
+void
+lock_acquire (struct lock *lock)
+{
+  ASSERT (!lock_held_by_current_thread (lock));
+  sema_down (&lock->semaphore);
+  lock->holder = thread_current ();
+}
+
+bool
+lock_try_acquire (struct lock *lock)
+{
+  ASSERT (!lock_held_by_current_thread (lock));
+  if (!sema_try_down (&lock->semaphore))
+    return false;
+  lock->holder = thread_current ();
+  return true;
+}
+
+void
+lock_release (struct lock *lock)
+{
+  ASSERT (lock_held_by_current_thread (lock));
+  lock->holder = NULL;
+  sema_up (&lock->semaphore);
+}
+
+bool
+lock_held_by_current_thread (const struct lock *lock)
+{
+  return lock->holder == thread_current ();
+}
+
+void
+rwlock_init (struct rwlock *rw)
+{
+  rw->readers = 0;
+  rw->writer = NULL;
+  list_init (&rw->read_waiters);
+  list_init (&rw->write_waiters);
+}
+
+void
+rwlock_acquire_read (struct rwlock *rw)
+{
+  if (rw->writer != NULL)
+    PANIC ("rwlock_acquire_read would block forever in a single thread");
+  rw->readers++;
+}
+
+void
+rwlock_release_read (struct rwlock *rw)
+{
+  ASSERT (rw->readers > 0);
+  rw->readers--;
+}
+
+void
+rwlock_acquire_write (struct rwlock *rw)
+{
+  if (rw->writer != NULL || rw->readers > 0)
+    PANIC ("rwlock_acquire_write would block forever in a single thread");
+  rw->writer = thread_current ();
+}
+
+void
+rwlock_release_write (struct rwlock *rw)
+{
+  ASSERT (rwlock_held_for_write (rw));
+  rw->writer = NULL;
+}
+
+bool
+rwlock_held_for_write (const struct rwlock *rw)
+{
+  return rw->writer == thread_current ();
+}
+
+/* Prints a panic message and exits. */
+void
+debug_panic (const char *file, int line, const char *function,
+             const char *message, ...)
+{
+  va_list args;
+
+  printf ("PANIC at %s:%d in %s(): ", file, line, function);
+  va_start (args, message);
+  vprintf (message, args);
+  va_end (args);
+  printf ("\n");
+  hostio_exit (2);
+}
+
+/* Dumps the SIZE bytes in BUF to the console as hex bytes.
+   Simpler than lib/stdio.c's version, which is only used here
+   by bitmap_dump(). */
+void
+hex_dump (uintptr_t ofs UNUSED, const void *buf_, size_t size, bool ascii UNUSED)
+{
+  const uint8_t *buf = buf_;
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    printf ("%s%02x%s", i % 16 == 0 ? "" : " ", buf[i],
+            i % 16 == 15 || i + 1 == size ? "\n" : "");
+}
+
+/* The Linux C library lacks strlcpy() and strlcat(), which the
+   file system code uses.  These follow lib/string.c. */
+size_t
+strlcpy (char *dst, const char *src, size_t size)
+{
+  size_t src_len = strlen (src);
+
+  if (size > 0)
+    {
+      size_t dst_len = size - 1;
+      if (src_len < dst_len)
+        dst_len = src_len;
+      memcpy (dst, src, dst_len);
+      dst[dst_len] = '\0';
+    }
+  return src_len;
+}
+
+size_t
+strlcat (char *dst, const char *src, size_t size)
+{
+  size_t src_len = strlen (src);
+  size_t dst_len = strlen (dst);
+
+  if (size > 0 && dst_len < size)
+    {
+      size_t copy_cnt = size - dst_len - 1;
+      if (src_len < copy_cnt)
+        copy_cnt = src_len;
+      memcpy (dst + dst_len, src, copy_cnt);
+      dst[dst_len + copy_cnt] = '\0';
+    }
+  return src_len + dst_len;
+}
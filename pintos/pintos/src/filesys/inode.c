@@ -11,9 +11,22 @@
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
+/* Number of data blocks an inode can address: 122 direct, 128
+   through the indirect block, 128 * 128 through the doubly
+   indirect block. */
+#define MAX_BLOCKS (122 + 128 + 128 * 128)
+
+/* A run of consecutive free sectors, already marked in use in
+   the free map, from which blocks are handed out in order. */
+struct sector_run
+  {
+    block_sector_t start;       /* Next sector to hand out. */
+    size_t cnt;                 /* Sectors left in the run. */
+  };
+
 /* Helpers used to allocate / deallocate blocks from inode a la Unix */
 bool inode_change_block (struct inode_disk *inode_disk,
-    block_sector_t sector, bool add);
+    block_sector_t sector, bool add, struct sector_run *run);
 bool calculate_indices (int block, int *offsets, int *offset_cnt);
 
 /* Returns cache hit/miss rate count */
@@ -34,6 +47,70 @@ bytes_to_sectors (off_t size)
   return DIV_ROUND_UP (size, BLOCK_SECTOR_SIZE);
 }
 
+/* Returns the number of data blocks that have sectors assigned
+   in INODE_DISK.  This is normally just enough for its length,
+   but inode_reserve() can assign sectors beyond that.  Inodes
+   written before next_sector_index was maintained have it 0. */
+static size_t
+allocated_blocks (const struct inode_disk *inode_disk)
+{
+  size_t blocks = bytes_to_sectors (inode_disk->length);
+  return inode_disk->next_sector_index > blocks
+         ? inode_disk->next_sector_index : blocks;
+}
+
+/* Returns the number of indirect and doubly indirect blocks
+   needed to extend an inode from FROM to TO data blocks. */
+static size_t
+index_blocks_needed (size_t from, size_t to)
+{
+  size_t cnt = 0;
+  size_t block;
+
+  for (block = from; block < to; block++)
+    if (block == 122)
+      cnt++;
+    else if (block >= 250 && (block - 250) % 128 == 0)
+      cnt += block == 250 ? 2 : 1;
+  return cnt;
+}
+
+/* Hands out the next sector of RUN into *SECTORP, or allocates a
+   single sector from the free map if RUN is null or used up. */
+static bool
+take_sector (struct sector_run *run, block_sector_t *sectorp)
+{
+  if (run != NULL && run->cnt > 0)
+    {
+      *sectorp = run->start++;
+      run->cnt--;
+      return true;
+    }
+  return free_map_allocate (1, sectorp);
+}
+
+/* Returns the sector assigned to data block BLOCK of INODE_DISK,
+   which must have been allocated. */
+static block_sector_t
+block_to_sector (const struct inode_disk *inode_disk, size_t block)
+{
+  block_sector_t pointers[128];
+  int offsets[2] = {0, 0};
+  int offset_cnt = 0;
+
+  calculate_indices (block, offsets, &offset_cnt);
+  if (offset_cnt == 1)
+    return inode_disk->pointers[offsets[0]];
+  if (offset_cnt == 2)
+    {
+      cache_read_block (inode_disk->pointers[122], pointers);
+      return pointers[offsets[0]];
+    }
+  cache_read_block (inode_disk->pointers[123], pointers);
+  cache_read_block (pointers[offsets[0]], pointers);
+  return pointers[offsets[1]];
+}
+
 /* Returns the block device sector that contains byte offset POS
    within INODE.
    Returns -1 if INODE does not contain data for a byte at offset
@@ -53,8 +130,8 @@ byte_to_sector (const struct inode *inode, off_t pos)
   block_sector_t result = -1;
   cache_read_block (inode->sector, inode_disk);
 
-  int offsets[2];
-  int offset_cnt;
+  int offsets[2] = {0, 0};
+  int offset_cnt = 0;
   // Finds the sector indices for an offset in this inode data
   calculate_indices (pos / BLOCK_SECTOR_SIZE, offsets, &offset_cnt);
 
@@ -195,7 +272,7 @@ inode_open (block_sector_t sector)
   inode->removed = false;
   cache_read_block (inode->sector, &inode->data);
   inode->is_dir = inode->data.is_dir;
-  sema_init (&inode->alloc_sema, 1);
+  rwlock_init (&inode->meta_lock);
   return inode;
 }
 
@@ -253,12 +330,12 @@ inode_close (struct inode *inode)
           // Deallocate all blocks pointed to by this inode!
           struct inode_disk *resize_temp =
               malloc (sizeof (struct inode_disk));
-          sema_down (&inode->alloc_sema);
+          rwlock_acquire_write (&inode->meta_lock);
           cache_read_block (inode->sector, resize_temp);
           inode_resize_file(resize_temp, 0);
           free (resize_temp);
           free_map_release(inode->sector, 1);
-          sema_up (&inode->alloc_sema);
+          rwlock_release_write (&inode->meta_lock);
         }
 
       free (inode);
@@ -291,14 +368,15 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
   off_t bytes_read = 0;
   uint8_t *bounce = NULL;
 
+  /* Keep the block pointers still while we follow them. */
+  rwlock_acquire_read (&inode->meta_lock);
   while (size > 0)
     {
       /* Disk sector to read, starting byte offset within sector. */
       block_sector_t sector_idx = byte_to_sector (inode, offset);
       // If this sector has not been allocated, we need to exit
-      if (sector_idx == -1) {
-        return bytes_read;
-      }
+      if (sector_idx == (block_sector_t) -1)
+        break;
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
 
       /* Bytes left in inode, bytes left in sector, lesser of the two. */
@@ -335,11 +413,39 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       offset += chunk_size;
       bytes_read += chunk_size;
     }
+  rwlock_release_read (&inode->meta_lock);
   free (bounce);
 
   return bytes_read;
 }
 
+/* Grows INODE to at least LENGTH bytes.  Takes the block
+   pointers exclusively, and checks the length again under the
+   lock, since another writer may have grown the file first.
+   Returns true if successful, false if out of memory or disk
+   space. */
+static bool
+inode_extend (struct inode *inode, off_t length)
+{
+  struct inode_disk *resize_temp = malloc (sizeof (struct inode_disk));
+  bool success = true;
+
+  if (resize_temp == NULL)
+    return false;
+
+  rwlock_acquire_write (&inode->meta_lock);
+  cache_read_block (inode->sector, resize_temp);
+  if (resize_temp->length < length)
+    {
+      success = inode_resize_file (resize_temp, length);
+      if (success)
+        cache_write_block (inode->sector, resize_temp);
+    }
+  rwlock_release_write (&inode->meta_lock);
+  free (resize_temp);
+  return success;
+}
+
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
    Returns the number of bytes actually written, which may be
    less than SIZE if end of file is reached or an error occurs.
@@ -356,25 +462,16 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
   if (inode->deny_write_cnt)
     return 0;
 
-  // Check if we need to resize the file with this write
-  struct inode_disk *resize_temp = malloc (sizeof (struct inode_disk));
-  // Down on the allocate sema so nobody else is resizing
-  sema_down (&inode->alloc_sema);
-  cache_read_block (inode->sector, resize_temp);
-  if (resize_temp->length < offset + size)
-  {
-    if (!inode_resize_file(resize_temp, offset + size)) {
-      // if the resize fails, we exit
-      sema_up (&inode->alloc_sema);
-      free(resize_temp);
-      return 0;
+  // Writers within the file share the block pointers with readers,
+  // only growing the file needs them exclusively
+  rwlock_acquire_read (&inode->meta_lock);
+  if (inode_length (inode) < offset + size)
+    {
+      rwlock_release_read (&inode->meta_lock);
+      if (!inode_extend (inode, offset + size))
+        return 0;
+      rwlock_acquire_read (&inode->meta_lock);
     }
-    // update the inode disk
-    cache_write_block (inode->sector, resize_temp);
-  }
-  sema_up (&inode->alloc_sema);
-  free (resize_temp);
-
   while (size > 0)
     {
       /* Sector to write, starting byte offset within sector. */
@@ -422,66 +519,138 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       offset += chunk_size;
       bytes_written += chunk_size;
     }
+  rwlock_release_read (&inode->meta_lock);
   free (bounce);
 
   return bytes_written;
 }
 
-/* Helper function for resizing an inode_disk to a certain length */
+/* Helper function for resizing an inode_disk to a certain length.
+   Blocks that inode_reserve() set aside are zeroed as the file
+   grows over them, rather than allocated.  Truncating (to any
+   length not greater than the current one) releases every block
+   past the new end, reserved or not, last block first so that
+   each indirect block is freed only after the pointers in it. */
 bool
 inode_resize_file(struct inode_disk *inode_disk, off_t length)
 {
+  size_t alloc_blocks; // num of blocks with sectors
   size_t curr_blocks; // num of current blocks
   size_t new_blocks; // num of needed blocks
-  off_t curr;
-  off_t d_curr;
+  size_t curr;
 
-  curr_blocks = (inode_disk->length + BLOCK_SECTOR_SIZE - 1) / BLOCK_SECTOR_SIZE;
-  new_blocks = (length + BLOCK_SECTOR_SIZE - 1) / BLOCK_SECTOR_SIZE;
+  alloc_blocks = allocated_blocks (inode_disk);
+  curr_blocks = bytes_to_sectors (inode_disk->length);
+  new_blocks = bytes_to_sectors (length);
+  if (new_blocks > MAX_BLOCKS)
+    return false;
 
   if (new_blocks > curr_blocks)
   {
-    // allocate blocks from [curr_blocks+1, new_blocks];
-    for (curr = curr_blocks; curr < new_blocks; curr++)
+    // allocate blocks from [alloc_blocks, new_blocks)
+    for (curr = alloc_blocks; curr < new_blocks; curr++)
     {
-      if (!inode_change_block (inode_disk, curr, true))
+      if (!inode_change_block (inode_disk, curr, true, NULL))
       {
         // must deallocate if failed to allocate
-        for (d_curr = curr_blocks; d_curr < curr; d_curr++)
-        {
-          inode_change_block (inode_disk, d_curr, false);
-        }
+        while (curr-- > alloc_blocks)
+          inode_change_block (inode_disk, curr, false, NULL);
         return false;
       }
     }
-    inode_disk->length = length;
-    return true;
+    if (new_blocks > alloc_blocks)
+      inode_disk->next_sector_index = new_blocks;
+
+    // zero reserved blocks from [curr_blocks, min(alloc_blocks, new_blocks))
+    if (curr_blocks < alloc_blocks)
+    {
+      static const uint8_t zeros[BLOCK_SECTOR_SIZE];
+      for (curr = curr_blocks; curr < alloc_blocks && curr < new_blocks;
+           curr++)
+        cache_write_block (block_to_sector (inode_disk, curr),
+                           (void *) zeros);
+    }
   }
-  else if (curr_blocks > new_blocks)
+  else if (length <= inode_disk->length)
   {
-    // deallocate blocks from [new_blocks+1, curr_blocks];
-    for (curr = new_blocks; curr < curr_blocks; curr++)
+    // deallocate blocks from [new_blocks, alloc_blocks), last first
+    for (curr = alloc_blocks; curr-- > new_blocks; )
+      inode_change_block (inode_disk, curr, false, NULL);
+    inode_disk->next_sector_index = new_blocks;
+  }
+  inode_disk->length = length;
+  return true;
+}
+
+/* Reserves sectors for the data of INODE up to byte LENGTH, as
+   for fallocate(), without changing its length or writing to
+   the new sectors.  The sectors come from as few runs of
+   consecutive free sectors as possible, in the same order as
+   inode_resize_file() would allocate them one by one, so a file
+   that is reserved up front and then written sequentially is
+   laid out sequentially on disk.  Does nothing for the part of
+   the range that already has sectors.  Returns false if LENGTH
+   is too large or the disk is full, in which case nothing is
+   reserved. */
+bool
+inode_reserve (struct inode *inode, off_t length)
+{
+  struct inode_disk *inode_disk;
+  struct sector_run run = {0, 0};
+  size_t alloc_blocks, new_blocks, curr;
+  bool success = true;
+
+  if (length < 0 || bytes_to_sectors (length) > MAX_BLOCKS)
+    return false;
+  inode_disk = malloc (sizeof *inode_disk);
+  if (inode_disk == NULL)
+    return false;
+
+  rwlock_acquire_write (&inode->meta_lock);
+  cache_read_block (inode->sector, inode_disk);
+  alloc_blocks = allocated_blocks (inode_disk);
+  new_blocks = bytes_to_sectors (length);
+
+  for (curr = alloc_blocks; curr < new_blocks; curr++)
+  {
+    if (run.cnt == 0)
+      run.cnt = free_map_allocate_run (new_blocks - curr
+                                       + index_blocks_needed (curr,
+                                                              new_blocks),
+                                       &run.start);
+    if (run.cnt == 0 || !inode_change_block (inode_disk, curr, true, &run))
     {
-      inode_change_block (inode_disk, curr, false);
+      // undo the blocks reserved so far
+      while (curr-- > alloc_blocks)
+        inode_change_block (inode_disk, curr, false, NULL);
+      success = false;
+      break;
     }
-    inode_disk->length = length;
-    return true;
   }
-  else
+  if (run.cnt > 0)
+    free_map_release (run.start, run.cnt);
+
+  if (success && new_blocks > alloc_blocks)
   {
-    inode_disk->length = length;
-    return true;
+    inode_disk->next_sector_index = new_blocks;
+    cache_write_block (inode->sector, inode_disk);
   }
+  rwlock_release_write (&inode->meta_lock);
+  free (inode_disk);
+  return success;
 }
 
 /* Helper function for allocating / deallocating a
- * sector at a certain pointer index */
+ * sector at a certain pointer index.  New sectors come from RUN
+ * if it is non-null; data blocks taken from a run are only
+ * being reserved, so they are not zeroed here (see
+ * inode_resize_file()). */
 bool
 inode_change_block (struct inode_disk *inode_disk,
-    block_sector_t block, bool add)
+    block_sector_t block, bool add, struct sector_run *run)
 {
-  int offsets[2];
-  int offset_cnt;
+  int offsets[2] = {0, 0};
+  int offset_cnt = 0;
   uint8_t zeros[BLOCK_SECTOR_SIZE];
 
   memset (zeros, 0, sizeof (zeros));
@@ -493,11 +662,12 @@ inode_change_block (struct inode_disk *inode_disk,
     if (add)
     {
       block_sector_t next_direct;
-      if (!free_map_allocate(1, &next_direct)) {
+      if (!take_sector (run, &next_direct)) {
         return false;
       }
       inode_disk->pointers[offsets[0]] = next_direct;
-      cache_write_block (next_direct, zeros);
+      if (run == NULL)
+        cache_write_block (next_direct, zeros);
       return true;
     }
     // remove the block
@@ -520,7 +690,7 @@ inode_change_block (struct inode_disk *inode_disk,
       if (indirect_sector == 0)
       {
         // we need an indirect pointer block first
-        if (!free_map_allocate (1, &indirect_sector)) {
+        if (!take_sector (run, &indirect_sector)) {
           return false;
         }
         inode_disk->pointers[122] = indirect_sector;
@@ -530,12 +700,13 @@ inode_change_block (struct inode_disk *inode_disk,
 
       // allocate a new block
       block_sector_t next_indirect;
-      if (!free_map_allocate (1, &next_indirect)) {
+      if (!take_sector (run, &next_indirect)) {
         return false;
       }
       // save the pointer to the new block
       indirect_inode_disk.pointers[offsets[0]] = next_indirect;
-      cache_write_block (next_indirect, zeros);
+      if (run == NULL)
+        cache_write_block (next_indirect, zeros);
       cache_write_block (indirect_sector, &indirect_inode_disk);
       return true;
     }
@@ -574,7 +745,7 @@ inode_change_block (struct inode_disk *inode_disk,
       if (doubly_indirect_sector == 0)
       {
         // if not then we need one
-        if (!free_map_allocate (1, &doubly_indirect_sector)) {
+        if (!take_sector (run, &doubly_indirect_sector)) {
           return false;
         }
         inode_disk->pointers[123] = doubly_indirect_sector;
@@ -587,7 +758,7 @@ inode_change_block (struct inode_disk *inode_disk,
       if (indirect_sector == 0)
       {
         // if not we need one
-        if (!free_map_allocate (1, &indirect_sector)) {
+        if (!take_sector (run, &indirect_sector)) {
           return false;
         }
         doubly_indirect_inode_disk.pointers[offsets[0]] = indirect_sector;
@@ -597,12 +768,13 @@ inode_change_block (struct inode_disk *inode_disk,
       cache_read_block (indirect_sector, &indirect_inode_disk);
 
       block_sector_t next_doubly_indirect;
-      if (!free_map_allocate (1, &next_doubly_indirect)) {
+      if (!take_sector (run, &next_doubly_indirect)) {
         return false;
       }
       // save pointers to the new blocks
       indirect_inode_disk.pointers[offsets[1]] = next_doubly_indirect;
-      cache_write_block (next_doubly_indirect, zeros);
+      if (run == NULL)
+        cache_write_block (next_doubly_indirect, zeros);
       cache_write_block (indirect_sector, &indirect_inode_disk);
       return true;
     }
@@ -700,6 +872,5 @@ inode_length (const struct inode *inode)
 {
   struct inode_disk i_disk;
   cache_read_block (inode->sector, &i_disk);
-  cache_write_block (inode->sector, &i_disk);
   return i_disk.length;
 }
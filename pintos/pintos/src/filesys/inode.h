@@ -14,7 +14,10 @@ struct bitmap;
 struct inode_disk
   {
     off_t length;                       /* File size in bytes. */
-    uint32_t next_sector_index;         /* index of next pointer to allocate */
+    uint32_t next_sector_index;         /* index of next pointer to allocate
+                                         * (data blocks with sectors, which
+                                         * inode_reserve() can make more
+                                         * than the length needs) */
     block_sector_t pointers[124];       /* 122 direct pointers,
                                          * 1 indirect, 1 doubly-indirect */
     uint32_t is_dir;                    /* is this inode_disk a directory */
@@ -29,7 +32,9 @@ struct inode
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
-    struct semaphore alloc_sema;        /* lock for file extending */
+    struct rwlock meta_lock;            /* Guards the block pointers: shared
+                                           to read or write data, exclusive
+                                           to grow, reserve or free. */
     bool is_dir;                        /* Copied in from inode_disk (1=T, 0=F). */
     struct inode_disk data;             /* Inode content. */
   };
@@ -65,6 +70,7 @@ void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
 off_t inode_length (const struct inode *);
 bool inode_resize_file (struct inode_disk *, off_t length);
+bool inode_reserve (struct inode *, off_t length);
 int get_cache_stats (int stats);
 
 #endif /* filesys/inode.h */
@@ -0,0 +1,33 @@
+#ifndef __LIB_BLOCK_STATS_H
+#define __LIB_BLOCK_STATS_H
+
+/* Per-device block I/O statistics.  Shared between the kernel's
+   block layer (devices/block.c) and user programs, which obtain
+   a copy for the file system device with the blkstats() system
+   call. */
+
+/* Number of buckets in each latency histogram.  Bucket I counts
+   requests that took at least 2**I but less than 2**(I+1) TSC
+   cycles; the last bucket also absorbs anything slower. */
+#define BLOCK_LATENCY_BUCKETS 40
+
+struct block_stats
+  {
+    unsigned long long read_cnt;        /* Number of sectors read. */
+    unsigned long long write_cnt;       /* Number of sectors written. */
+    unsigned long long bytes_read;      /* Bytes transferred by reads. */
+    unsigned long long bytes_written;   /* Bytes transferred by writes. */
+
+    unsigned long long seq_cnt;         /* Requests for last sector + 1. */
+    unsigned long long random_cnt;      /* All other requests. */
+
+    unsigned long long depth_sum;       /* Sum of queue depth at submit. */
+    unsigned max_depth;                 /* Deepest queue observed. */
+
+    unsigned long long read_cycles;     /* Total TSC cycles in reads. */
+    unsigned long long write_cycles;    /* Total TSC cycles in writes. */
+    unsigned read_latency[BLOCK_LATENCY_BUCKETS];
+    unsigned write_latency[BLOCK_LATENCY_BUCKETS];
+  };
+
+#endif /* lib/block-stats.h */
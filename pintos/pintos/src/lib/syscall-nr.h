@@ -31,7 +31,12 @@ enum
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
     SYS_INUMBER,                /* Returns the inode number for a fd. */
     CACHE_STATS,                /* Returns cache stats. */
-    SYS_WRTCNT                  /* Returns the FILESYS block write count */
+    SYS_WRTCNT,                 /* Returns the FILESYS block write count */
+    SYS_BLKSTATS,               /* Returns the FILESYS block I/O stats. */
+    SYS_TICKS,                  /* Returns timer ticks since boot. */
+    SYS_TICKFREQ,               /* Returns timer ticks per second. */
+    SYS_FALLOCATE,              /* Reserves disk space for a file. */
+    SYS_THREADSTAT              /* Returns the caller's thread stats. */
   };
 
 #endif /* lib/syscall-nr.h */
@@ -0,0 +1,30 @@
+#ifndef __LIB_THREAD_STATS_H
+#define __LIB_THREAD_STATS_H
+
+/* Per-thread scheduling and system call statistics.  Kept by the
+   kernel in struct thread and obtained by user programs, for the
+   calling thread, with the threadstat() system call.  Times are
+   in TSC cycles. */
+
+/* Number of system call numbers counted individually in
+   syscall_cnt[].  Calls with higher numbers are only counted in
+   syscall_total. */
+#define THREAD_STATS_SYSCALLS 32
+
+struct thread_stats
+  {
+    unsigned long long run_cycles;      /* Time spent running. */
+    unsigned long long ready_cycles;    /* Time in the ready queue. */
+    unsigned long long blocked_cycles;  /* Time blocked. */
+
+    unsigned long long user_ticks;      /* Timer ticks as a process. */
+    unsigned long long kernel_ticks;    /* Timer ticks as a kernel thread. */
+
+    unsigned long long voluntary_switches;   /* Switches on blocking. */
+    unsigned long long involuntary_switches; /* Preempted or yielded. */
+
+    unsigned long long syscall_total;   /* System calls made. */
+    unsigned syscall_cnt[THREAD_STATS_SYSCALLS]; /* Calls per number. */
+  };
+
+#endif /* lib/thread-stats.h */
@@ -189,6 +189,12 @@ inumber (int fd)
   return syscall1 (SYS_INUMBER, fd);
 }
 
+bool
+fallocate (int fd, unsigned offset, unsigned length)
+{
+  return syscall3 (SYS_FALLOCATE, fd, offset, length);
+}
+
 int
 cache_stats (int stats)
 {
@@ -201,3 +207,28 @@ wrtcnt (void)
   return syscall0 (SYS_WRTCNT);
 }
 
+bool
+blkstats (struct block_stats *stats)
+{
+  return syscall1 (SYS_BLKSTATS, stats);
+}
+
+long long
+ticks (void)
+{
+  long long t;
+  syscall1 (SYS_TICKS, &t);
+  return t;
+}
+
+int
+tick_freq (void)
+{
+  return syscall0 (SYS_TICKFREQ);
+}
+
+bool
+threadstat (struct thread_stats *stats)
+{
+  return syscall1 (SYS_THREADSTAT, stats);
+}
@@ -3,6 +3,8 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <block-stats.h>
+#include <thread-stats.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -45,9 +47,14 @@ bool mkdir (const char *dir);
 bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
+bool fallocate (int fd, unsigned offset, unsigned length);
 
 /* Additional Tests */
 int cache_stats (int stats);
 unsigned long long wrtcnt (void);
+bool blkstats (struct block_stats *);
+long long ticks (void);
+int tick_freq (void);
+bool threadstat (struct thread_stats *);
 
 #endif /* lib/user/syscall.h */
@@ -0,0 +1,48 @@
+/* Measures metadata operations: creates a storm of small files
+   in a fresh directory, writing one sector to each, then deletes
+   them all. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/filesys/bench/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 200
+#define FILE_SIZE 512
+
+static char buf[FILE_SIZE];
+
+void
+test_main (void)
+{
+  char name[32];
+  struct bench b;
+  int i;
+
+  if (!mkdir ("storm"))
+    fail ("mkdir \"storm\" failed");
+
+  bench_start (&b);
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      int fd;
+
+      snprintf (name, sizeof name, "storm/f%d", i);
+      if (!create (name, 0) || (fd = open (name)) < 2)
+        fail ("create \"%s\" failed", name);
+      if (write (fd, buf, FILE_SIZE) != FILE_SIZE)
+        fail ("write \"%s\" failed", name);
+      close (fd);
+    }
+  bench_report (&b, "create", FILE_CNT * FILE_SIZE, FILE_CNT);
+
+  bench_start (&b);
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "storm/f%d", i);
+      if (!remove (name))
+        fail ("remove \"%s\" failed", name);
+    }
+  bench_report (&b, "delete", 0, FILE_CNT);
+}
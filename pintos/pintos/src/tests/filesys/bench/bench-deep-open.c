@@ -0,0 +1,41 @@
+/* Measures path resolution: opens and closes a file at the
+   bottom of a chain of nested directories, by absolute path,
+   over and over. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/filesys/bench/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define DEPTH 16
+#define OPEN_CNT 200
+
+void
+test_main (void)
+{
+  char path[DEPTH * 4 + 16];
+  struct bench b;
+  int i;
+
+  path[0] = '\0';
+  for (i = 0; i < DEPTH; i++)
+    {
+      strlcat (path, "/dir", sizeof path);
+      if (!mkdir (path))
+        fail ("mkdir \"%s\" failed", path);
+    }
+  strlcat (path, "/file", sizeof path);
+  if (!create (path, 0))
+    fail ("create \"%s\" failed", path);
+
+  bench_start (&b);
+  for (i = 0; i < OPEN_CNT; i++)
+    {
+      int fd = open (path);
+      if (fd < 2)
+        fail ("open \"%s\" failed", path);
+      close (fd);
+    }
+  bench_report (&b, "deep-open", 0, OPEN_CNT);
+}
@@ -0,0 +1,55 @@
+/* Measures directory lookups in a large directory: fills a
+   directory with empty files, then opens each of them, and
+   looks up as many names that do not exist, in random order. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/filesys/bench/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 300
+
+static int order[FILE_CNT];
+
+void
+test_main (void)
+{
+  char name[32];
+  struct bench b;
+  int i;
+
+  if (!mkdir ("big"))
+    fail ("mkdir \"big\" failed");
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "big/file%d", i);
+      if (!create (name, 0))
+        fail ("create \"%s\" failed", name);
+      order[i] = i;
+    }
+  random_init (0);
+  shuffle (order, FILE_CNT, sizeof *order);
+
+  bench_start (&b);
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      int fd;
+
+      snprintf (name, sizeof name, "big/file%d", order[i]);
+      if ((fd = open (name)) < 2)
+        fail ("open \"%s\" failed", name);
+      close (fd);
+    }
+  bench_report (&b, "dir-lookup", 0, FILE_CNT);
+
+  bench_start (&b);
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "big/none%d", order[i]);
+      if (open (name) != -1)
+        fail ("open \"%s\" succeeded", name);
+    }
+  bench_report (&b, "dir-lookup-miss", 0, FILE_CNT);
+}
@@ -0,0 +1,57 @@
+/* Measures random 512-byte I/O: writes, then reads, randomly
+   chosen sectors of a 512 kB file, which is large enough that
+   most of them miss in the buffer cache. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/filesys/bench/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define BLOCK_SIZE 512
+#define BLOCK_CNT 1024
+#define OP_CNT 1024
+
+static char buf[BLOCK_SIZE];
+
+/* Runs OP_CNT reads or writes on FD at random block offsets. */
+static void
+random_io (int fd, bool writing)
+{
+  int i;
+
+  for (i = 0; i < OP_CNT; i++)
+    {
+      size_t ofs = random_ulong () % BLOCK_CNT * BLOCK_SIZE;
+      seek (fd, ofs);
+      if ((writing ? write (fd, buf, BLOCK_SIZE) : read (fd, buf, BLOCK_SIZE))
+          != BLOCK_SIZE)
+        fail ("%s %d bytes at offset %zu failed",
+              writing ? "write" : "read", BLOCK_SIZE, ofs);
+    }
+}
+
+void
+test_main (void)
+{
+  const char *file_name = "random";
+  struct bench b;
+  int fd;
+
+  random_init (0);
+  if (!create (file_name, BLOCK_SIZE * BLOCK_CNT))
+    fail ("create \"%s\" failed", file_name);
+  if ((fd = open (file_name)) < 2)
+    fail ("open \"%s\" failed", file_name);
+
+  bench_start (&b);
+  random_io (fd, true);
+  bench_report (&b, "random-write", OP_CNT * BLOCK_SIZE, OP_CNT);
+
+  bench_start (&b);
+  random_io (fd, false);
+  bench_report (&b, "random-read", OP_CNT * BLOCK_SIZE, OP_CNT);
+
+  close (fd);
+  remove (file_name);
+}
@@ -0,0 +1,4 @@
+# -*- perl -*-
+use tests::tests;
+use tests::filesys::bench::bench;
+check_bench ('random-write', 'random-read');
@@ -0,0 +1,42 @@
+/* Measures sequential throughput: writes a 1 MB file from
+   scratch, 4 kB at a time, then reads it back the same way. */
+
+#include <syscall.h>
+#include "tests/filesys/bench/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (1024 * 1024)
+#define CHUNK_SIZE 4096
+
+static char buf[CHUNK_SIZE];
+
+void
+test_main (void)
+{
+  const char *file_name = "seq";
+  struct bench b;
+  size_t ofs;
+  int fd;
+
+  if (!create (file_name, 0))
+    fail ("create \"%s\" failed", file_name);
+  if ((fd = open (file_name)) < 2)
+    fail ("open \"%s\" failed", file_name);
+
+  bench_start (&b);
+  for (ofs = 0; ofs < FILE_SIZE; ofs += CHUNK_SIZE)
+    if (write (fd, buf, CHUNK_SIZE) != CHUNK_SIZE)
+      fail ("write %d bytes at offset %zu failed", CHUNK_SIZE, ofs);
+  bench_report (&b, "seq-write", FILE_SIZE, FILE_SIZE / CHUNK_SIZE);
+
+  seek (fd, 0);
+  bench_start (&b);
+  for (ofs = 0; ofs < FILE_SIZE; ofs += CHUNK_SIZE)
+    if (read (fd, buf, CHUNK_SIZE) != CHUNK_SIZE)
+      fail ("read %d bytes at offset %zu failed", CHUNK_SIZE, ofs);
+  bench_report (&b, "seq-read", FILE_SIZE, FILE_SIZE / CHUNK_SIZE);
+
+  close (fd);
+  remove (file_name);
+}
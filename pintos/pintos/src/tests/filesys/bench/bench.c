@@ -0,0 +1,46 @@
+#include "tests/filesys/bench/bench.h"
+#include <syscall.h>
+#include "tests/lib.h"
+
+/* Arguments to cache_stats(). */
+#define CACHE_MISSES 0
+#define CACHE_CALLS 1
+
+/* Samples the counters into B.  Waits for the start of a fresh
+   timer tick first, so that a measurement does not begin partway
+   through one. */
+void
+bench_start (struct bench *b)
+{
+  long long start = ticks ();
+  while (ticks () == start)
+    continue;
+
+  b->ticks = ticks ();
+  b->cache_calls = cache_stats (CACHE_CALLS);
+  b->cache_misses = cache_stats (CACHE_MISSES);
+  b->dev_writes = wrtcnt ();
+}
+
+/* Prints the result of the measurement begun by B, for workload
+   NAME, which transferred BYTES bytes in OPS operations. */
+void
+bench_report (const struct bench *b, const char *name,
+              unsigned long long bytes, unsigned long long ops)
+{
+  long long elapsed = ticks () - b->ticks;
+  unsigned long long freq = tick_freq ();
+  unsigned long long kb_per_sec = 0, ops_per_sec = 0;
+
+  if (elapsed > 0)
+    {
+      kb_per_sec = bytes * freq / 1024 / elapsed;
+      ops_per_sec = ops * freq / elapsed;
+    }
+  msg ("bench: name=%s bytes=%llu ops=%llu ticks=%lld kb_per_sec=%llu "
+       "ops_per_sec=%llu cache_calls=%d cache_misses=%d dev_writes=%llu",
+       name, bytes, ops, elapsed, kb_per_sec, ops_per_sec,
+       cache_stats (CACHE_CALLS) - b->cache_calls,
+       cache_stats (CACHE_MISSES) - b->cache_misses,
+       wrtcnt () - b->dev_writes);
+}
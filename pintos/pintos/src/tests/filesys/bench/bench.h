@@ -0,0 +1,33 @@
+#ifndef TESTS_FILESYS_BENCH_BENCH_H
+#define TESTS_FILESYS_BENCH_BENCH_H
+
+/* Timing and reporting for the file system benchmarks.
+
+   Each benchmark brackets a workload with bench_start() and
+   bench_report().  bench_report() prints a single line of
+   space-separated key=value pairs, prefixed by "bench:", that
+   "make bench" collects into bench.results:
+
+     (bench-seq) bench: name=seq-write bytes=1048576 ops=256
+       ticks=31 kb_per_sec=33032 ops_per_sec=8258
+       cache_calls=5419 cache_misses=2081 dev_writes=2064
+
+   (shown wrapped; it is one line).  Rates are 0 if the workload
+   finished within a single timer tick.  They are computed with
+   the kernel's tick rate, so they hold under the "-hz" kernel
+   option too. */
+
+/* Counters sampled at the start of a measurement. */
+struct bench
+  {
+    long long ticks;                    /* ticks(). */
+    int cache_calls;                    /* cache_stats (1). */
+    int cache_misses;                   /* cache_stats (0). */
+    unsigned long long dev_writes;      /* wrtcnt(). */
+  };
+
+void bench_start (struct bench *);
+void bench_report (const struct bench *, const char *name,
+                   unsigned long long bytes, unsigned long long ops);
+
+#endif /* tests/filesys/bench/bench.h */
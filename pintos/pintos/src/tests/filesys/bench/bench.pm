@@ -0,0 +1,40 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+# check_bench (@NAMES)
+#
+# Checks that the benchmark ran to completion and printed one
+# well-formed result line for each workload in @NAMES, in order.
+# The measurements themselves vary from run to run and are not
+# checked.
+sub check_bench {
+    my (@names) = @_;
+    our ($test);
+    my ($name) = $test =~ m%([^/]+)$%;
+
+    my (@output) = read_text_file ("$test.output");
+    common_checks ("run", @output);
+    @output = get_core_output ("run", @output);
+
+    fail "missing begin message\n" if $output[0] ne "($name) begin";
+    fail "missing end message\n"
+      if !grep ($_ eq "($name) end", @output);
+
+    my (@results) = grep (/^\($name\) bench: /, @output);
+    fail scalar (@results) . " results, expected " . scalar (@names) . "\n"
+      if @results != @names;
+    foreach my $result (@results) {
+	my ($expected) = shift (@names);
+	fail "malformed result: $result\n"
+	  if $result !~ /^\($name\)\ bench:\ name=\Q$expected\E
+			 \ bytes=\d+\ ops=\d+\ ticks=\d+
+			 \ kb_per_sec=\d+\ ops_per_sec=\d+
+			 \ cache_calls=\d+\ cache_misses=\d+
+			 \ dev_writes=\d+$/x;
+    }
+    pass;
+}
+
+1;
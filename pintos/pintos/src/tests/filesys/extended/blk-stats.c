@@ -0,0 +1,64 @@
+/* Writes a file sector by sector and checks that the block
+   layer's per-device statistics, as reported by blkstats(),
+   agree with each other and with wrtcnt(). */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define BLOCK_SECTOR_SIZE 512
+#define SECTOR_CNT 32
+
+static struct block_stats stats;
+static char buf[BLOCK_SECTOR_SIZE];
+
+/* Returns the sum of the BLOCK_LATENCY_BUCKETS entries in
+   HISTOGRAM. */
+static unsigned long long
+histogram_total (const unsigned histogram[BLOCK_LATENCY_BUCKETS])
+{
+  unsigned long long total = 0;
+  int i;
+
+  for (i = 0; i < BLOCK_LATENCY_BUCKETS; i++)
+    total += histogram[i];
+  return total;
+}
+
+void
+test_main (void)
+{
+  int fd;
+  int i;
+
+  memset (buf, 0, sizeof buf);
+  CHECK (create ("stats", 0), "create \"stats\"");
+  CHECK ((fd = open ("stats")) > 1, "open \"stats\"");
+
+  msg ("writing %d sectors...", SECTOR_CNT);
+  for (i = 0; i < SECTOR_CNT; i++)
+    if (write (fd, buf, sizeof buf) != sizeof buf)
+      fail ("write of sector %d failed", i);
+  close (fd);
+
+  CHECK (blkstats (&stats), "blkstats");
+
+  if ((unsigned) stats.write_cnt != (unsigned) wrtcnt ())
+    fail ("blkstats write count %d != wrtcnt %d",
+          (int) stats.write_cnt, (int) wrtcnt ());
+  if (stats.read_cnt == 0)
+    fail ("no reads recorded");
+  if (stats.bytes_read != stats.read_cnt * BLOCK_SECTOR_SIZE
+      || stats.bytes_written != stats.write_cnt * BLOCK_SECTOR_SIZE)
+    fail ("byte counts disagree with sector counts");
+  if (stats.seq_cnt + stats.random_cnt != stats.read_cnt + stats.write_cnt)
+    fail ("sequential + random != total requests");
+  if (histogram_total (stats.read_latency) != stats.read_cnt
+      || histogram_total (stats.write_latency) != stats.write_cnt)
+    fail ("latency histograms disagree with request counts");
+  if (stats.max_depth < 1
+      || stats.depth_sum < stats.read_cnt + stats.write_cnt)
+    fail ("queue depth not recorded");
+  msg ("block statistics are consistent");
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(blk-stats) begin
+(blk-stats) create "stats"
+(blk-stats) open "stats"
+(blk-stats) writing 32 sectors...
+(blk-stats) blkstats
+(blk-stats) block statistics are consistent
+(blk-stats) end
+EOF
+pass;
@@ -0,0 +1,6 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_archive ({"prealloc" => ["\0" x 32768 . "x" x 8192]});
+pass;
@@ -0,0 +1,37 @@
+/* Reserves space for a file with fallocate, checks that its size
+   is unchanged, then writes past the end of file into the
+   reserved space and verifies that the gap reads back as
+   zeros.  Also checks that fallocate fails cleanly on a bad fd
+   and when the disk cannot hold the reservation. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[40960];
+
+void
+test_main (void)
+{
+  const char *file_name = "prealloc";
+  int fd;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (fallocate (fd, 0, 65536), "fallocate 64 kB");
+  CHECK (filesize (fd) == 0, "size is still 0");
+  CHECK (!fallocate (fd, 0, 4 * 1024 * 1024),
+         "fallocate more than the disk holds (must fail)");
+  CHECK (!fallocate (fd + 100, 0, 512), "fallocate bad fd (must fail)");
+
+  memset (buf + 32768, 'x', sizeof buf - 32768);
+  msg ("seek \"%s\"", file_name);
+  seek (fd, 32768);
+  CHECK (write (fd, buf + 32768, sizeof buf - 32768) == sizeof buf - 32768,
+         "write \"%s\"", file_name);
+  CHECK (filesize (fd) == sizeof buf, "size is %zu", sizeof buf);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  check_file (file_name, buf, sizeof buf);
+}
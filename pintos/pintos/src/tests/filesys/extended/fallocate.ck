@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fallocate) begin
+(fallocate) create "prealloc"
+(fallocate) open "prealloc"
+(fallocate) fallocate 64 kB
+(fallocate) size is still 0
+(fallocate) fallocate more than the disk holds (must fail)
+(fallocate) fallocate bad fd (must fail)
+(fallocate) seek "prealloc"
+(fallocate) write "prealloc"
+(fallocate) size is 40960
+(fallocate) close "prealloc"
+(fallocate) open "prealloc" for verification
+(fallocate) verified contents of "prealloc"
+(fallocate) close "prealloc"
+(fallocate) end
+EOF
+pass;
@@ -0,0 +1,78 @@
+/* Checks that readers share a readers-writer lock and that
+   writers take precedence over readers that arrive later.
+
+   The main thread and a reader hold the lock for reading
+   together.  Then a writer and a later reader wait for it.  Once
+   both readers release it, the writer must get it before the
+   later reader. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+struct rwlock_data
+  {
+    struct rwlock rw;                   /* Lock under test. */
+    struct semaphore go;                /* Tells the reader to release. */
+  };
+
+static thread_func reader_thread_func;
+static thread_func writer_thread_func;
+static thread_func late_reader_thread_func;
+
+void
+test_rwlock (void)
+{
+  struct rwlock_data data;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&data.rw);
+  sema_init (&data.go, 0);
+  rwlock_acquire_read (&data.rw);
+  thread_create ("reader", PRI_DEFAULT + 1, reader_thread_func, &data);
+  thread_create ("writer", PRI_DEFAULT + 3, writer_thread_func, &data);
+  thread_create ("late-reader", PRI_DEFAULT + 2,
+                 late_reader_thread_func, &data);
+  msg ("main releasing read lock.");
+  rwlock_release_read (&data.rw);
+  sema_up (&data.go);
+}
+
+static void
+reader_thread_func (void *data_)
+{
+  struct rwlock_data *data = data_;
+
+  rwlock_acquire_read (&data->rw);
+  msg ("reader acquired read lock alongside main.");
+  sema_down (&data->go);
+  msg ("reader releasing read lock.");
+  rwlock_release_read (&data->rw);
+}
+
+static void
+writer_thread_func (void *data_)
+{
+  struct rwlock_data *data = data_;
+
+  rwlock_acquire_write (&data->rw);
+  msg ("writer acquired write lock.");
+  rwlock_release_write (&data->rw);
+}
+
+static void
+late_reader_thread_func (void *data_)
+{
+  struct rwlock_data *data = data_;
+
+  rwlock_acquire_read (&data->rw);
+  msg ("late reader acquired read lock.");
+  rwlock_release_read (&data->rw);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock) begin
+(rwlock) reader acquired read lock alongside main.
+(rwlock) main releasing read lock.
+(rwlock) reader releasing read lock.
+(rwlock) writer acquired write lock.
+(rwlock) late reader acquired read lock.
+(rwlock) end
+EOF
+pass;
@@ -0,0 +1,92 @@
+/* Checks the timed variants of the synchronization primitives.
+
+   sema_down_timeout() on a semaphore that nobody ups must give
+   up after the timeout and leave the waiters list empty.
+   lock_acquire_timeout() on a lock held by a lower-priority
+   thread must give up too, and take back the priority it
+   donated while waiting.  cond_wait_timeout() must report
+   whether it was signaled or timed out. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+struct timeout_data
+  {
+    struct lock lock;                   /* Lock to hold or signal under. */
+    struct condition cond;              /* Condition to signal. */
+    struct semaphore done;              /* Upped by main to release holder. */
+  };
+
+static thread_func holder_thread_func;
+static thread_func signaler_thread_func;
+
+void
+test_synch_timeout (void)
+{
+  struct timeout_data data;
+  struct semaphore sema;
+  int64_t start;
+  bool success;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  sema_init (&sema, 0);
+  start = timer_ticks ();
+  success = sema_down_timeout (&sema, 10);
+  msg ("sema_down_timeout on a 0 semaphore returned %s after %s 10 ticks.",
+       success ? "true" : "false",
+       timer_elapsed (start) >= 10 ? "at least" : "fewer than");
+  msg ("Semaphore waiters list is %s.",
+       list_empty (&sema.waiters) ? "empty" : "not empty");
+  sema_up (&sema);
+  msg ("sema_down_timeout on a 1 semaphore returned %s.",
+       sema_down_timeout (&sema, 10) ? "true" : "false");
+
+  lock_init (&data.lock);
+  cond_init (&data.cond);
+  sema_init (&data.done, 0);
+  thread_create ("holder", PRI_DEFAULT + 1, holder_thread_func, &data);
+  thread_set_priority (PRI_DEFAULT + 5);
+  msg ("lock_acquire_timeout on a held lock returned %s.",
+       lock_acquire_timeout (&data.lock, 10) ? "true" : "false");
+  sema_up (&data.done);
+  thread_set_priority (PRI_DEFAULT);
+
+  lock_acquire (&data.lock);
+  msg ("cond_wait_timeout without a signal returned %s.",
+       cond_wait_timeout (&data.cond, &data.lock, 10) ? "true" : "false");
+  thread_create ("signaler", PRI_DEFAULT - 1, signaler_thread_func, &data);
+  msg ("cond_wait_timeout with a signal returned %s.",
+       cond_wait_timeout (&data.cond, &data.lock, 1000) ? "true" : "false");
+  lock_release (&data.lock);
+}
+
+static void
+holder_thread_func (void *data_)
+{
+  struct timeout_data *data = data_;
+
+  lock_acquire (&data->lock);
+  sema_down (&data->done);
+  msg ("Holder has priority %d after the donor timed out.",
+       thread_get_priority ());
+  lock_release (&data->lock);
+}
+
+static void
+signaler_thread_func (void *data_)
+{
+  struct timeout_data *data = data_;
+
+  lock_acquire (&data->lock);
+  cond_signal (&data->cond, &data->lock);
+  lock_release (&data->lock);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(synch-timeout) begin
+(synch-timeout) sema_down_timeout on a 0 semaphore returned false after at least 10 ticks.
+(synch-timeout) Semaphore waiters list is empty.
+(synch-timeout) sema_down_timeout on a 1 semaphore returned true.
+(synch-timeout) lock_acquire_timeout on a held lock returned false.
+(synch-timeout) Holder has priority 32 after the donor timed out.
+(synch-timeout) cond_wait_timeout without a signal returned false.
+(synch-timeout) cond_wait_timeout with a signal returned true.
+(synch-timeout) end
+EOF
+pass;
@@ -0,0 +1,39 @@
+/* Checks that threadstat() accounts for this process's system
+   calls, run time, and the time it spends blocked waiting for a
+   child. */
+
+#include <syscall.h>
+#include <syscall-nr.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PRACTICE_CNT 10
+
+static struct thread_stats before, after;
+
+void
+test_main (void)
+{
+  int i;
+
+  CHECK (threadstat (&before), "threadstat");
+  for (i = 0; i < PRACTICE_CNT; i++)
+    practice (i);
+  msg ("wait(exec()) = %d", wait (exec ("child-simple")));
+  CHECK (threadstat (&after), "threadstat");
+
+  if (after.syscall_cnt[SYS_PRACTICE] - before.syscall_cnt[SYS_PRACTICE]
+      != PRACTICE_CNT)
+    fail ("counted %u practice calls, expected %d",
+          after.syscall_cnt[SYS_PRACTICE] - before.syscall_cnt[SYS_PRACTICE],
+          PRACTICE_CNT);
+  if (before.syscall_cnt[SYS_THREADSTAT] == 0)
+    fail ("threadstat call not counted");
+  if (after.syscall_total - before.syscall_total < PRACTICE_CNT + 3)
+    fail ("syscall total did not grow enough");
+  if (after.run_cycles <= before.run_cycles)
+    fail ("run time did not grow");
+  if (after.voluntary_switches <= before.voluntary_switches
+      || after.blocked_cycles <= before.blocked_cycles)
+    fail ("waiting for the child was not accounted as blocked");
+}
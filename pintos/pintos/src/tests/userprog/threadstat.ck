@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(threadstat) begin
+(threadstat) threadstat
+(child-simple) run
+child-simple: exit(81)
+(threadstat) wait(exec()) = 81
+(threadstat) threadstat
+(threadstat) end
+threadstat: exit(0)
+EOF
+pass;
@@ -0,0 +1,40 @@
+#ifndef THREADS_CPU_H
+#define THREADS_CPU_H
+
+#include <stdint.h>
+
+/* Returns the processor's time-stamp counter, which increments
+   once per clock cycle (or at a constant rate, on newer CPUs)
+   since reset.  Cheap enough to call on every disk request or
+   context switch.  See [IA32-v2b] "RDTSC". */
+static inline uint64_t
+rdtsc (void)
+{
+  uint32_t lo, hi;
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+}
+
+/* Feature flags returned in EDX by CPUID function 1.  See
+   [IA32-v2a] "CPUID". */
+#define CPUID_PSE 0x00000008    /* 4 MB pages. */
+#define CPUID_PGE 0x00002000    /* Global pages. */
+
+/* CR4 bits that enable those features.  See [IA32-v3a] 2.5
+   "Control Registers". */
+#define CR4_PSE 0x00000010      /* Page size extensions. */
+#define CR4_PGE 0x00000080      /* Page global enable. */
+
+/* Returns the feature flags that CPUID function 1 reports in
+   EDX. */
+static inline uint32_t
+cpuid_features (void)
+{
+  uint32_t eax, ebx, ecx, edx;
+  asm volatile ("cpuid"
+                : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+                : "a" (1));
+  return edx;
+}
+
+#endif /* threads/cpu.h */
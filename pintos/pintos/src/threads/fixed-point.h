@@ -45,11 +45,12 @@ fix_frac (int n, int d)
   return __mk_fix ((long long) n * FIX_F / d);
 }
 
-/* Returns X rounded to the nearest integer. */
+/* Returns X rounded to the nearest integer, halves away from
+   zero. */
 static inline int
 fix_round (fixed_point_t x)
 {
-  return (x.f + FIX_F / 2) / FIX_F;
+  return (x.f >= 0 ? x.f + FIX_F / 2 : x.f - FIX_F / 2) / FIX_F;
 }
 
 /* Returns X truncated down to the nearest integer. */
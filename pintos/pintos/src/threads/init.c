@@ -15,13 +15,17 @@
 #include "devices/timer.h"
 #include "devices/vga.h"
 #include "devices/rtc.h"
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/smp.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -37,6 +41,11 @@
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+#endif
 
 /* Page directory with kernel mappings only. */
 uint32_t *init_page_dir;
@@ -57,6 +66,9 @@ static const char *swap_bdev_name;
 /* -ul: Maximum number of pages to put into palloc's user pool. */
 static size_t user_page_limit = SIZE_MAX;
 
+/* -trace: Record kernel events for trace_print()? */
+static bool enable_trace;
+
 static void bss_init (void);
 static void paging_init (void);
 
@@ -98,6 +110,12 @@ main (void)
   palloc_init (user_page_limit);
   malloc_init ();
   paging_init ();
+  smp_init ();
+  if (enable_trace)
+    trace_init ();
+#ifdef VM
+  frame_init ();
+#endif
 
   /* Segmentation. */
 #ifdef USERPROG
@@ -117,6 +135,7 @@ main (void)
 
   /* Start thread scheduler and enable interrupts. */
   thread_start ();
+  workqueue_init ();
   serial_init_queue ();
   timer_calibrate ();
 
@@ -125,6 +144,9 @@ main (void)
   ide_init ();
   locate_block_devices ();
   filesys_init (format_filesys);
+#ifdef VM
+  swap_init ();
+#endif
 #endif
 
   printf ("Boot complete.\n");
@@ -153,17 +175,26 @@ bss_init (void)
 /* Populates the base page directory and page table with the
    kernel virtual mapping, and then sets up the CPU to use the
    new page directory.  Points init_page_dir to the page
-   directory it creates. */
+   directory it creates.
+
+   If the CPU supports them, each whole 4 MB of RAM is mapped
+   with a single large page, and kernel mappings are global, so
+   that they take fewer TLB entries and survive the CR3 reloads
+   done on every process switch.  Kernel mappings never change
+   after this, so they never need to be flushed. */
 static void
 paging_init (void)
 {
   uint32_t *pd, *pt;
   size_t page;
   extern char _start, _end_kernel_text;
+  uint32_t features = cpuid_features ();
+  bool large_pages = (features & CPUID_PSE) != 0;
+  uint32_t global = (features & CPUID_PGE) != 0 ? PTE_G : 0;
 
   pd = init_page_dir = palloc_get_page (PAL_ASSERT | PAL_ZERO);
   pt = NULL;
-  for (page = 0; page < init_ram_pages; page++)
+  for (page = 0; page < init_ram_pages; )
     {
       uintptr_t paddr = page * PGSIZE;
       char *vaddr = ptov (paddr);
@@ -171,13 +202,38 @@ paging_init (void)
       size_t pte_idx = pt_no (vaddr);
       bool in_kernel_text = &_start <= vaddr && vaddr < &_end_kernel_text;
 
+      /* The kernel's code is read-only, so the 4 MB that hold it
+         need page granularity. */
+      if (large_pages && pte_idx == 0
+          && init_ram_pages - page >= PTSPAN / PGSIZE
+          && (&_end_kernel_text <= vaddr || vaddr + PTSPAN <= &_start))
+        {
+          pd[pde_idx] = pde_create_large_kernel (vaddr, true) | global;
+          page += PTSPAN / PGSIZE;
+          continue;
+        }
+
       if (pd[pde_idx] == 0)
         {
           pt = palloc_get_page (PAL_ASSERT | PAL_ZERO);
           pd[pde_idx] = pde_create (pt);
         }
 
-      pt[pte_idx] = pte_create_kernel (vaddr, !in_kernel_text);
+      pt[pte_idx] = pte_create_kernel (vaddr, !in_kernel_text) | global;
+      page++;
+    }
+
+  /* Large pages must be enabled before they are used, and
+     global pages take effect once enabled.  CR4 does not exist
+     on CPUs without either feature.  See [IA32-v3a] 2.5
+     "Control Registers". */
+  if (large_pages || global)
+    {
+      uint32_t cr4;
+
+      asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+      cr4 |= (large_pages ? CR4_PSE : 0) | (global ? CR4_PGE : 0);
+      asm volatile ("movl %0, %%cr4" : : "r" (cr4));
     }
 
   /* Store the physical address of the page directory into CR3
@@ -256,9 +312,27 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-trace"))
+        enable_trace = true;
+      else if (!strcmp (name, "-hz"))
+        {
+          int hz = atoi (value);
+          if (hz < TIMER_FREQ_MIN || hz > TIMER_FREQ_MAX)
+            PANIC ("-hz must be between %d and %d",
+                   TIMER_FREQ_MIN, TIMER_FREQ_MAX);
+          timer_set_freq (hz);
+        }
+      else if (!strcmp (name, "-tickless"))
+        timer_tickless = true;
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
+      else if (!strcmp (name, "-tstats"))
+        thread_exit_stats = true;
+#endif
+#ifdef VM
+      else if (!strcmp (name, "-stack"))
+        page_stack_max = (size_t) atoi (value) * 1024;
 #endif
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
@@ -379,8 +453,15 @@ usage (void)
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -trace             Trace kernel events, print them at power off.\n"
+          "  -hz=FREQ           Make the timer tick FREQ times per second.\n"
+          "  -tickless          Stop the timer tick while idle.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+          "  -tstats            Print each process's statistics on exit.\n"
+#endif
+#ifdef VM
+          "  -stack=KB          Let user stacks grow to KB kB (default 8192).\n"
 #endif
           );
   shutdown_power_off ();
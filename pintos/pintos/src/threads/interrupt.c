@@ -7,6 +7,7 @@
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
 #include "devices/timer.h"
 
@@ -47,6 +48,20 @@ static unsigned int unexpected_cnt[INTR_CNT];
 static bool in_external_intr;   /* Are we processing an external interrupt? */
 static bool yield_on_return;    /* Should we yield on interrupt return? */
 
+/* Softirqs.  An external interrupt that arrives while softirqs
+   are running leaves any it raises, and any yield it requests,
+   to the outer interrupt, which is already running them. */
+static softirq_func *softirq_handlers[SOFTIRQ_CNT];
+static unsigned softirq_pending;        /* Bit N set if softirq N raised. */
+static bool in_softirq;                 /* Running softirq handlers? */
+
+/* Passes through the pending softirqs at one interrupt exit
+   before leaving the rest for the next interrupt, so that
+   softirqs that keep raising themselves cannot starve threads. */
+#define SOFTIRQ_MAX_RESTART 10
+
+static void run_softirqs (void);
+
 /* Programmable Interrupt Controller helpers. */
 static void pic_init (void);
 static void pic_end_of_interrupt (int irq);
@@ -206,12 +221,12 @@ intr_register_int (uint8_t vec_no, int dpl, enum intr_level level,
   register_handler (vec_no, dpl, level, handler, name);
 }
 
-/* Returns true during processing of an external interrupt
-   and false at all other times. */
+/* Returns true during processing of an external interrupt or
+   a softirq and false at all other times. */
 bool
 intr_context (void)
 {
-  return in_external_intr;
+  return in_external_intr || in_softirq;
 }
 
 /* During processing of an external interrupt, directs the
@@ -225,6 +240,60 @@ intr_yield_on_return (void)
   yield_on_return = true;
 }
 
+/* Registers HANDLER to run for softirq NR. */
+void
+intr_register_softirq (enum softirq nr, softirq_func *handler)
+{
+  ASSERT (nr < SOFTIRQ_CNT);
+  ASSERT (softirq_handlers[nr] == NULL);
+
+  softirq_handlers[nr] = handler;
+}
+
+/* Marks softirq NR pending, so that its handler runs when the
+   current external interrupt returns.  Must be called from an
+   external interrupt handler or a softirq handler. */
+void
+intr_raise_softirq (enum softirq nr)
+{
+  enum intr_level old_level;
+
+  ASSERT (nr < SOFTIRQ_CNT);
+  ASSERT (intr_context ());
+
+  old_level = intr_disable ();
+  softirq_pending |= 1u << nr;
+  intr_set_level (old_level);
+}
+
+/* Runs the handlers for pending softirqs, with interrupts
+   enabled.  Called with interrupts off at the end of an external
+   interrupt; returns with interrupts off. */
+static void
+run_softirqs (void)
+{
+  int restart;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (!in_softirq);
+
+  in_softirq = true;
+  for (restart = 0; softirq_pending != 0 && restart < SOFTIRQ_MAX_RESTART;
+       restart++)
+    {
+      unsigned pending = softirq_pending;
+      int nr;
+
+      softirq_pending = 0;
+      intr_enable ();
+      for (nr = 0; nr < SOFTIRQ_CNT; nr++)
+        if ((pending & (1u << nr)) && softirq_handlers[nr] != NULL)
+          softirq_handlers[nr] ();
+      intr_disable ();
+    }
+  in_softirq = false;
+}
+
 /* 8259A Programmable Interrupt Controller. */
 
 /* Initializes the PICs.  Refer to [8259A] for details.
@@ -355,13 +424,16 @@ intr_handler (struct intr_frame *frame)
   if (external)
     {
       ASSERT (intr_get_level () == INTR_OFF);
-      ASSERT (!intr_context ());
+      ASSERT (!in_external_intr);
 
       in_external_intr = true;
-      yield_on_return = false;
+      if (!in_softirq)
+        yield_on_return = false;
+      timer_irq_enter ();
     }
 
   /* Invoke the interrupt's handler. */
+  trace (TRACE_INTR_ENTER, frame->vec_no, 0);
   handler = intr_handlers[frame->vec_no];
   if (handler != NULL)
     handler (frame);
@@ -373,6 +445,7 @@ intr_handler (struct intr_frame *frame)
     }
   else
     unexpected_interrupt (frame);
+  trace (TRACE_INTR_EXIT, frame->vec_no, 0);
 
   /* Complete the processing of an external interrupt. */
   if (external)
@@ -383,8 +456,13 @@ intr_handler (struct intr_frame *frame)
       in_external_intr = false;
       pic_end_of_interrupt (frame->vec_no);
 
-      if (yield_on_return)
-        thread_yield ();
+      if (!in_softirq)
+        {
+          if (softirq_pending != 0)
+            run_softirqs ();
+          if (yield_on_return)
+            thread_yield ();
+        }
     }
 }
 
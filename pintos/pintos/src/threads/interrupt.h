@@ -64,6 +64,22 @@ void intr_register_int (uint8_t vec, int dpl, enum intr_level,
 bool intr_context (void);
 void intr_yield_on_return (void);
 
+/* Softirqs: work that an external interrupt handler defers until
+   just before the interrupt returns, after the PIC has been
+   acknowledged, and which then runs with interrupts enabled.
+   Softirq handlers count as interrupt context: they may not
+   sleep, but they may wake threads and call
+   intr_yield_on_return(). */
+enum softirq
+  {
+    SOFTIRQ_TIMER,        /* Expired timers (devices/timer.c). */
+    SOFTIRQ_CNT
+  };
+
+typedef void softirq_func (void);
+void intr_register_softirq (enum softirq, softirq_func *);
+void intr_raise_softirq (enum softirq);
+
 void intr_dump_frame (const struct intr_frame *);
 const char *intr_name (uint8_t vec);
 
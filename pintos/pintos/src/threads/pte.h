@@ -51,7 +51,8 @@ static inline uintptr_t pd_no (const void *va) {
    |         Physical Address           |         Flags          |
    +------------------------------------+------------------------+
 
-   In a PDE, the physical address points to a page table.
+   In a PDE, the physical address points to a page table, or,
+   if PTE_PS is set, to a 4 MB page (for kernel memory only).
    In a PTE, the physical address points to a data or code page.
    The important flags are listed below.
    When a PDE or PTE is not "present", the other flags are
@@ -66,6 +67,9 @@ static inline uintptr_t pd_no (const void *va) {
 #define PTE_U 0x4               /* 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20              /* 1=accessed, 0=not acccessed. */
 #define PTE_D 0x40              /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_PS 0x80             /* 1=4 MB page, 0=page table (PDEs only). */
+#define PTE_G 0x100             /* 1=global: kept in the TLB when CR3
+                                   is loaded (pages only). */
 
 /* Returns a PDE that points to page table PT. */
 static inline uint32_t pde_create (uint32_t *pt) {
@@ -73,10 +77,20 @@ static inline uint32_t pde_create (uint32_t *pt) {
   return vtop (pt) | PTE_U | PTE_P | PTE_W;
 }
 
+/* Returns a PDE that maps the 4 MB of kernel memory at PAGE,
+   which must be 4 MB aligned, as one large page.
+   If WRITABLE is true then it will be writable as well.
+   Requires CR4_PSE. */
+static inline uint32_t pde_create_large_kernel (void *page, bool writable) {
+  ASSERT ((uintptr_t) page % PTSPAN == 0);
+  return vtop (page) | PTE_PS | PTE_P | (writable ? PTE_W : 0);
+}
+
 /* Returns a pointer to the page table that page directory entry
-   PDE, which must "present", points to. */
+   PDE, which must "present" and not a large page, points to. */
 static inline uint32_t *pde_get_pt (uint32_t pde) {
   ASSERT (pde & PTE_P);
+  ASSERT (!(pde & PTE_PS));
   return ptov (pde & PTE_ADDR);
 }
 
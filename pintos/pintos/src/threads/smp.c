@@ -0,0 +1,154 @@
+#include "threads/smp.h"
+#include <debug.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/loader.h"
+#include "threads/vaddr.h"
+
+/* MP floating pointer structure.  See [MP] 4.1. */
+struct mp_fps
+  {
+    char signature[4];          /* "_MP_". */
+    uint32_t config;            /* Physical address of struct mp_config. */
+    uint8_t length;             /* Length in 16-byte units. */
+    uint8_t spec_rev;           /* MP spec revision. */
+    uint8_t checksum;           /* All bytes must sum to 0. */
+    uint8_t features[5];        /* Feature bytes. */
+  } __attribute__ ((packed));
+
+/* MP configuration table header.  See [MP] 4.2.  Entries follow
+   the header. */
+struct mp_config
+  {
+    char signature[4];          /* "PCMP". */
+    uint16_t length;            /* Length of base table, with header. */
+    uint8_t spec_rev;           /* MP spec revision. */
+    uint8_t checksum;           /* All bytes must sum to 0. */
+    char oem_id[8];
+    char product_id[12];
+    uint32_t oem_table;
+    uint16_t oem_table_size;
+    uint16_t entry_cnt;         /* Number of entries. */
+    uint32_t lapic;             /* Physical address of local APIC. */
+    uint16_t ext_length;
+    uint8_t ext_checksum;
+    uint8_t reserved;
+  } __attribute__ ((packed));
+
+/* Processor entry in the MP configuration table.  See [MP]
+   4.3.1.  Other entries are 8 bytes long. */
+#define MP_PROCESSOR 0
+struct mp_processor
+  {
+    uint8_t type;               /* MP_PROCESSOR. */
+    uint8_t apic_id;            /* Local APIC ID. */
+    uint8_t apic_version;
+    uint8_t flags;              /* MP_CPU_* flags. */
+    uint32_t signature;
+    uint32_t features;
+    uint32_t reserved[2];
+  } __attribute__ ((packed));
+#define MP_CPU_ENABLED 0x01
+
+/* Returns true if the SIZE bytes at P sum to 0 modulo 256. */
+static bool
+checksum_ok (const void *p_, size_t size)
+{
+  const uint8_t *p = p_;
+  uint8_t sum = 0;
+
+  while (size-- > 0)
+    sum += *p++;
+  return sum == 0;
+}
+
+/* Returns true if physical addresses [PADDR, PADDR + SIZE) are
+   in RAM, and thus mapped at ptov(PADDR). */
+static bool
+in_ram (uintptr_t paddr, size_t size)
+{
+  uintptr_t ram_size = (uintptr_t) init_ram_pages * PGSIZE;
+  return paddr < ram_size && size <= ram_size - paddr;
+}
+
+/* Searches the SIZE bytes of physical memory at PADDR for the MP
+   floating pointer structure. */
+static const struct mp_fps *
+search_fps (uintptr_t paddr, size_t size)
+{
+  uintptr_t p;
+
+  if (!in_ram (paddr, size))
+    return NULL;
+  for (p = paddr; p + sizeof (struct mp_fps) <= paddr + size; p += 16)
+    {
+      const struct mp_fps *fps = ptov (p);
+      if (!memcmp (fps->signature, "_MP_", 4)
+          && checksum_ok (fps, sizeof *fps))
+        return fps;
+    }
+  return NULL;
+}
+
+/* Finds the MP floating pointer structure where [MP] 4 says it
+   may be: in the first kilobyte of the extended BIOS data area,
+   in the last kilobyte of base memory, or in the BIOS ROM. */
+static const struct mp_fps *
+find_fps (void)
+{
+  uintptr_t ebda = *(uint16_t *) ptov (0x40e) << 4;
+  uintptr_t base_kb = *(uint16_t *) ptov (0x413);
+  const struct mp_fps *fps = NULL;
+
+  if (ebda != 0)
+    fps = search_fps (ebda, 1024);
+  if (fps == NULL && base_kb != 0)
+    fps = search_fps ((base_kb - 1) * 1024, 1024);
+  if (fps == NULL)
+    fps = search_fps (0xf0000, 0x10000);
+  return fps;
+}
+
+/* Counts the machine's enabled processors in the MP tables and
+   reports them if there is more than one.  Without the tables,
+   assumes that there is just the boot processor. */
+void
+smp_init (void)
+{
+  const struct mp_fps *fps = find_fps ();
+  const struct mp_config *config;
+  const uint8_t *entry, *end;
+  int cpu_cnt = 0;
+  int i;
+
+  if (fps == NULL || fps->config == 0
+      || !in_ram (fps->config, sizeof *config))
+    return;
+  config = ptov (fps->config);
+  if (memcmp (config->signature, "PCMP", 4)
+      || !in_ram (fps->config, config->length)
+      || !checksum_ok (config, config->length))
+    return;
+
+  /* Count the enabled processors. */
+  entry = (const uint8_t *) (config + 1);
+  end = (const uint8_t *) config + config->length;
+  for (i = 0; i < config->entry_cnt && entry < end; i++)
+    {
+      if (*entry == MP_PROCESSOR)
+        {
+          const struct mp_processor *p = (const void *) entry;
+          if (p->flags & MP_CPU_ENABLED)
+            cpu_cnt++;
+          entry += sizeof *p;
+        }
+      else
+        entry += 8;
+    }
+
+  if (cpu_cnt > 1)
+    printf ("SMP: found %d processors, using only the boot processor.\n",
+            cpu_cnt);
+}
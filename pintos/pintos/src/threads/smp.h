@@ -0,0 +1,16 @@
+#ifndef THREADS_SMP_H
+#define THREADS_SMP_H
+
+/* Multiprocessor detection.
+
+   smp_init() counts the machine's processors in the BIOS's
+   MultiProcessor Specification tables [MP] and reports them.
+   Only the boot processor runs Pintos: starting the others would
+   take an INIT-SIPI-SIPI sequence through the local APIC, a
+   real-mode trampoline and per-processor GDT, TSS and stacks,
+   and the kernel relies on intr_disable() for mutual
+   exclusion. */
+
+void smp_init (void);
+
+#endif /* threads/smp.h */
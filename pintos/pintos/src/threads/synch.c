@@ -31,6 +31,20 @@
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/cpu.h"
+#include "threads/trace.h"
+#include "devices/timer.h"
+
+static void donate_priority (struct lock *);
+static void revoke_priority (struct lock *);
+static void take_lock (struct lock *);
+
+/* Maximum length of a chain of nested donations, as when H waits
+   for a lock held by M, which waits for a lock held by L.
+   Bounds the time spent in lock_acquire() with interrupts off,
+   and breaks cycles left by buggy code that would deadlock
+   anyway. */
+#define DONATION_DEPTH_MAX 8
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -75,6 +89,68 @@ sema_down (struct semaphore *sema)
   intr_set_level (old_level);
 }
 
+/* Timer function for sema_down_timeout(): if THREAD_ is still
+   waiting on a semaphore, takes it off the semaphore's waiters
+   list and wakes it.  If it is not blocked, sema_up() has
+   already woken it and it will cancel this timer once it runs. */
+static void
+sema_timeout (struct timer *timer UNUSED, void *thread_)
+{
+  struct thread *t = thread_;
+  enum intr_level old_level = intr_disable ();
+
+  if (t->status == THREAD_BLOCKED)
+    {
+      list_remove (&t->elem);
+      thread_unblock (t);
+    }
+  intr_set_level (old_level);
+  thread_preempt ();
+}
+
+/* Down or "P" operation on a semaphore that gives up after
+   TICKS timer ticks.  Returns true if SEMA was decremented,
+   false if the time ran out first, in which case the thread is
+   no longer on SEMA's waiters list.  With TICKS <= 0, this is
+   the same as sema_try_down().
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+bool
+sema_down_timeout (struct semaphore *sema, int64_t ticks)
+{
+  struct thread *cur = thread_current ();
+  struct timer timer;
+  enum intr_level old_level;
+  int64_t deadline;
+  bool success;
+
+  ASSERT (sema != NULL);
+  ASSERT (!intr_context ());
+
+  if (ticks <= 0)
+    return sema_try_down (sema);
+
+  timer_setup (&timer, sema_timeout, cur);
+  old_level = intr_disable ();
+  deadline = timer_ticks () + ticks;
+  while (sema->value == 0 && timer_ticks () < deadline)
+    {
+      list_push_back (&sema->waiters, &cur->elem);
+      if (!timer_pending (&timer))
+        timer_add (&timer, deadline);
+      thread_block ();
+    }
+  timer_cancel (&timer);
+
+  success = sema->value > 0;
+  if (success)
+    sema->value--;
+  intr_set_level (old_level);
+
+  return success;
+}
+
 /* Down or "P" operation on a semaphore, but only if the
    semaphore is not already 0.  Returns true if the semaphore is
    decremented, false otherwise.
@@ -102,9 +178,12 @@ sema_try_down (struct semaphore *sema)
 }
 
 /* Up or "V" operation on a semaphore.  Increments SEMA's value
-   and wakes up one thread of those waiting for SEMA, if any.
+   and wakes up the highest-priority thread of those waiting for
+   SEMA, if any, yielding to it if it has a higher priority than
+   the running thread.
 
-   This function may be called from an interrupt handler. */
+   This function may be called from an interrupt handler, in
+   which case the yield happens when the handler returns. */
 void
 sema_up (struct semaphore *sema)
 {
@@ -114,10 +193,15 @@ sema_up (struct semaphore *sema)
 
   old_level = intr_disable ();
   if (!list_empty (&sema->waiters))
-    thread_unblock (list_entry (list_pop_front (&sema->waiters),
-                                struct thread, elem));
+    {
+      struct list_elem *e = list_max (&sema->waiters,
+                                      thread_priority_less, NULL);
+      list_remove (e);
+      thread_unblock (list_entry (e, struct thread, elem));
+    }
   sema->value++;
   intr_set_level (old_level);
+  thread_preempt ();
 }
 
 static void sema_test_helper (void *sema_);
@@ -185,6 +269,12 @@ lock_init (struct lock *lock)
    necessary.  The lock must not already be held by the current
    thread.
 
+   While waiting, donates the current thread's priority to the
+   lock's holder, and on down the chain if the holder is itself
+   waiting for a lock, so that a lower-priority holder cannot
+   keep us waiting behind threads of middling priority.  (The
+   MLFQS scheduler sets priorities itself and does not donate.)
+
    This function may sleep, so it must not be called within an
    interrupt handler.  This function may be called with
    interrupts disabled, but interrupts will be turned back on if
@@ -192,12 +282,120 @@ lock_init (struct lock *lock)
 void
 lock_acquire (struct lock *lock)
 {
+  enum intr_level old_level;
+
+  ASSERT (lock != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (!lock_held_by_current_thread (lock));
+
+  old_level = intr_disable ();
+  if (lock->holder != NULL && trace_enabled ())
+    {
+      /* Contended: trace how long we wait. */
+      uint64_t start = rdtsc ();
+      donate_priority (lock);
+      sema_down (&lock->semaphore);
+      trace (TRACE_LOCK_WAIT, (uint32_t) lock, rdtsc () - start);
+    }
+  else
+    {
+      donate_priority (lock);
+      sema_down (&lock->semaphore);
+    }
+  take_lock (lock);
+  intr_set_level (old_level);
+}
+
+/* Acquires LOCK like lock_acquire(), but gives up after TICKS
+   timer ticks.  Returns true if the lock was acquired.  On
+   timeout, withdraws the priority this thread donated while
+   waiting.  With TICKS <= 0, this is the same as
+   lock_try_acquire().
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+bool
+lock_acquire_timeout (struct lock *lock, int64_t ticks)
+{
+  enum intr_level old_level;
+  bool success;
+
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
-  sema_down (&lock->semaphore);
-  lock->holder = thread_current ();
+  old_level = intr_disable ();
+  donate_priority (lock);
+  success = sema_down_timeout (&lock->semaphore, ticks);
+  if (success)
+    take_lock (lock);
+  else
+    revoke_priority (lock);
+  intr_set_level (old_level);
+
+  return success;
+}
+
+/* Donates the current thread's priority, which is about to wait
+   for LOCK, to LOCK's holder and on down the chain of holders.
+   Must be called with interrupts off. */
+static void
+donate_priority (struct lock *lock)
+{
+  struct thread *cur = thread_current ();
+  int depth;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (lock->holder == NULL || thread_mlfqs)
+    return;
+
+  cur->waiting_lock = lock;
+  for (depth = 0; depth < DONATION_DEPTH_MAX; depth++)
+    {
+      if (lock == NULL || lock->holder == NULL
+          || lock->holder->priority >= cur->priority)
+        break;
+      thread_donate_priority (lock->holder, cur->priority);
+      lock = lock->holder->waiting_lock;
+    }
+}
+
+/* Undoes donate_priority() for a thread that has stopped waiting
+   for LOCK without acquiring it, by recomputing the priorities
+   down the chain of holders.  Must be called with interrupts
+   off. */
+static void
+revoke_priority (struct lock *lock)
+{
+  int depth;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  thread_current ()->waiting_lock = NULL;
+  if (thread_mlfqs)
+    return;
+  for (depth = 0; depth < DONATION_DEPTH_MAX; depth++)
+    {
+      if (lock == NULL || lock->holder == NULL)
+        break;
+      thread_update_priority (lock->holder);
+      lock = lock->holder->waiting_lock;
+    }
+}
+
+/* Records that the current thread, which has downed LOCK's
+   semaphore, holds LOCK.  Must be called with interrupts off. */
+static void
+take_lock (struct lock *lock)
+{
+  struct thread *cur = thread_current ();
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  cur->waiting_lock = NULL;
+  lock->holder = cur;
+  list_push_back (&cur->held_locks, &lock->elem);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -216,11 +414,17 @@ lock_try_acquire (struct lock *lock)
 
   success = sema_try_down (&lock->semaphore);
   if (success)
-    lock->holder = thread_current ();
+    {
+      enum intr_level old_level = intr_disable ();
+      take_lock (lock);
+      intr_set_level (old_level);
+    }
   return success;
 }
 
 /* Releases LOCK, which must be owned by the current thread.
+   Gives up any priority donated for LOCK, then wakes its
+   highest-priority waiter.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to release a lock within an interrupt
@@ -228,10 +432,16 @@ lock_try_acquire (struct lock *lock)
 void
 lock_release (struct lock *lock)
 {
+  enum intr_level old_level;
+
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
   lock->holder = NULL;
+  list_remove (&lock->elem);
+  thread_update_priority (thread_current ());
+  intr_set_level (old_level);
   sema_up (&lock->semaphore);
 }
 
@@ -246,13 +456,179 @@ lock_held_by_current_thread (const struct lock *lock)
   return lock->holder == thread_current ();
 }
 
+/* Initializes RW.  A readers-writer lock may be held by any
+   number of readers at once, or by a single writer.
+
+   Writers take precedence: a reader that arrives while a writer
+   holds or is waiting for the lock waits too, so a stream of
+   readers cannot starve writers.  When the lock becomes free,
+   it goes to the highest-priority waiting writer, unless a
+   waiting reader has a still higher priority, in which case all
+   the waiting readers get it together.  Waiting threads do not
+   donate priority to the holders.
+
+   Like locks, readers-writer locks are not recursive. */
+void
+rwlock_init (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  rw->readers = 0;
+  rw->writer = NULL;
+  list_init (&rw->read_waiters);
+  list_init (&rw->write_waiters);
+}
+
+/* Hands RW, which nobody holds, to the waiting threads that
+   should have it, as described at rwlock_init(), and wakes them.
+   Must be called with interrupts off. */
+static void
+rwlock_grant (struct rwlock *rw)
+{
+  struct thread *reader = NULL;
+  struct thread *writer = NULL;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (rw->readers == 0 && rw->writer == NULL);
+
+  if (!list_empty (&rw->read_waiters))
+    reader = list_entry (list_max (&rw->read_waiters,
+                                   thread_priority_less, NULL),
+                         struct thread, elem);
+  if (!list_empty (&rw->write_waiters))
+    writer = list_entry (list_max (&rw->write_waiters,
+                                   thread_priority_less, NULL),
+                         struct thread, elem);
+
+  if (writer != NULL
+      && (reader == NULL || writer->priority >= reader->priority))
+    {
+      list_remove (&writer->elem);
+      rw->writer = writer;
+      thread_unblock (writer);
+    }
+  else
+    while (!list_empty (&rw->read_waiters))
+      {
+        rw->readers++;
+        thread_unblock (list_entry (list_pop_front (&rw->read_waiters),
+                                    struct thread, elem));
+      }
+}
+
+/* Acquires RW for reading, sleeping until no writer holds or
+   is waiting for it if necessary.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw)
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (rw->writer != thread_current ());
+
+  old_level = intr_disable ();
+  if (rw->writer == NULL && list_empty (&rw->write_waiters))
+    rw->readers++;
+  else
+    {
+      /* rwlock_grant() counts us as a reader before waking us. */
+      list_push_back (&rw->read_waiters, &thread_current ()->elem);
+      thread_block ();
+    }
+  intr_set_level (old_level);
+}
+
+/* Releases RW, which the current thread holds for reading. */
+void
+rwlock_release_read (struct rwlock *rw)
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (rw->readers > 0);
+
+  old_level = intr_disable ();
+  if (--rw->readers == 0)
+    rwlock_grant (rw);
+  intr_set_level (old_level);
+  thread_preempt ();
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it if necessary.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (rw->writer != cur);
+
+  old_level = intr_disable ();
+  if (rw->writer == NULL && rw->readers == 0)
+    rw->writer = cur;
+  else
+    {
+      /* rwlock_grant() makes us the writer before waking us. */
+      list_push_back (&rw->write_waiters, &cur->elem);
+      thread_block ();
+    }
+  intr_set_level (old_level);
+}
+
+/* Releases RW, which the current thread holds for writing. */
+void
+rwlock_release_write (struct rwlock *rw)
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (rwlock_held_for_write (rw));
+
+  old_level = intr_disable ();
+  rw->writer = NULL;
+  rwlock_grant (rw);
+  intr_set_level (old_level);
+  thread_preempt ();
+}
+
+/* Returns true if the current thread holds RW for writing.
+   (Whether it holds RW for reading is not recorded.) */
+bool
+rwlock_held_for_write (const struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  return rw->writer == thread_current ();
+}
+
 /* One semaphore in a list. */
 struct semaphore_elem
   {
     struct list_elem elem;              /* List element. */
     struct semaphore semaphore;         /* This semaphore. */
+    struct thread *thread;              /* Thread waiting on it. */
   };
 
+/* Returns true if the waiter with list element A has lower
+   priority than the one with B. */
+static bool
+waiter_priority_less (const struct list_elem *a,
+                      const struct list_elem *b, void *aux UNUSED)
+{
+  return (list_entry (a, struct semaphore_elem, elem)->thread->priority
+          < list_entry (b, struct semaphore_elem, elem)->thread->priority);
+}
+
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
    code to receive the signal and act upon it. */
@@ -295,14 +671,54 @@ cond_wait (struct condition *cond, struct lock *lock)
   ASSERT (lock_held_by_current_thread (lock));
 
   sema_init (&waiter.semaphore, 0);
+  waiter.thread = thread_current ();
   list_push_back (&cond->waiters, &waiter.elem);
   lock_release (lock);
   sema_down (&waiter.semaphore);
   lock_acquire (lock);
 }
 
+/* Like cond_wait(), but stops waiting for COND after TICKS timer
+   ticks.  Either way, LOCK is reacquired before returning; the
+   time spent reacquiring it does not count against TICKS.
+   Returns true if COND was signaled, false on timeout.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+bool
+cond_wait_timeout (struct condition *cond, struct lock *lock,
+                   int64_t ticks)
+{
+  struct semaphore_elem waiter;
+
+  ASSERT (cond != NULL);
+  ASSERT (lock != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (lock_held_by_current_thread (lock));
+
+  sema_init (&waiter.semaphore, 0);
+  waiter.thread = thread_current ();
+  list_push_back (&cond->waiters, &waiter.elem);
+  lock_release (lock);
+  if (sema_down_timeout (&waiter.semaphore, ticks))
+    {
+      lock_acquire (lock);
+      return true;
+    }
+  lock_acquire (lock);
+
+  /* A signal may have picked this waiter between the timeout and
+     reacquiring LOCK.  If so, take it rather than lose it;
+     otherwise, the waiter is still on the list. */
+  if (sema_try_down (&waiter.semaphore))
+    return true;
+  list_remove (&waiter.elem);
+  return false;
+}
+
 /* If any threads are waiting on COND (protected by LOCK), then
-   this function signals one of them to wake up from its wait.
+   this function signals the highest-priority one to wake up
+   from its wait.
    LOCK must be held before calling this function.
 
    An interrupt handler cannot acquire a lock, so it does not
@@ -317,8 +733,12 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED)
   ASSERT (lock_held_by_current_thread (lock));
 
   if (!list_empty (&cond->waiters))
-    sema_up (&list_entry (list_pop_front (&cond->waiters),
-                          struct semaphore_elem, elem)->semaphore);
+    {
+      struct list_elem *e = list_max (&cond->waiters,
+                                      waiter_priority_less, NULL);
+      list_remove (e);
+      sema_up (&list_entry (e, struct semaphore_elem, elem)->semaphore);
+    }
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
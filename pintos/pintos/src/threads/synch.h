@@ -3,6 +3,7 @@
 
 #include <list.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 /* A counting semaphore. */
 struct semaphore
@@ -13,6 +14,7 @@ struct semaphore
 
 void sema_init (struct semaphore *, unsigned value);
 void sema_down (struct semaphore *);
+bool sema_down_timeout (struct semaphore *, int64_t ticks);
 bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
 void sema_self_test (void);
@@ -20,16 +22,34 @@ void sema_self_test (void);
 /* Lock. */
 struct lock
   {
-    struct thread *holder;      /* Thread holding lock (for debugging). */
+    struct thread *holder;      /* Thread holding lock. */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
+    struct list_elem elem;      /* Element in holder's held_locks. */
   };
 
 void lock_init (struct lock *);
 void lock_acquire (struct lock *);
+bool lock_acquire_timeout (struct lock *, int64_t ticks);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
 
+/* Readers-writer lock. */
+struct rwlock
+  {
+    unsigned readers;           /* Number of readers holding the lock. */
+    struct thread *writer;      /* Writer holding the lock, if any. */
+    struct list read_waiters;   /* Threads waiting to read. */
+    struct list write_waiters;  /* Threads waiting to write. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_for_write (const struct rwlock *);
+
 /* Condition variable. */
 struct condition
   {
@@ -38,6 +58,7 @@ struct condition
 
 void cond_init (struct condition *);
 void cond_wait (struct condition *, struct lock *);
+bool cond_wait_timeout (struct condition *, struct lock *, int64_t ticks);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
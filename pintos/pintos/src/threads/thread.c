@@ -4,6 +4,7 @@
 #include <random.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/cpu.h"
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
@@ -11,7 +12,9 @@
 #include "threads/malloc.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 #include "filesys/filesys.h"
 #include "filesys/directory.h"
 #ifdef USERPROG
@@ -23,9 +26,15 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Processes in THREAD_READY state, that is, processes that are
+   ready to run but not actually running, with one FIFO queue per
+   priority.  Bit PRI_MAX - P of ready_bitmap is set exactly when
+   ready_queues[P] is nonempty, so that the lowest set bit names
+   the highest nonempty queue. */
+#define PRI_CNT (PRI_MAX - PRI_MIN + 1)
+static struct list ready_queues[PRI_CNT];
+static uint64_t ready_bitmap;
+static int ready_cnt;           /* Threads in ready_queues. */
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
@@ -62,6 +71,26 @@ static unsigned thread_ticks;   /* # of timer ticks since last yield. */
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* If true, print user processes' statistics on exit.
+   Controlled by kernel command-line option "-tstats". */
+bool thread_exit_stats;
+
+/* MLFQS state.
+
+   load_avg and every thread's recent_cpu decay once a second.
+   Only the running thread and the ready threads are decayed on
+   time, since they are the only ones whose priorities matter.  A
+   blocked thread catches up when it is unblocked, replaying the
+   decays it missed from the history of decay coefficients, so
+   the once-a-second work is proportional to the number of ready
+   threads rather than to all threads. */
+#define PRIORITY_TICKS 4        /* Ticks between priority updates. */
+#define DECAY_HISTORY 256       /* Seconds of decay coefficients kept. */
+static fixed_point_t load_avg;  /* Estimated ready threads, last minute. */
+static unsigned decay_seconds;  /* Decays applied so far. */
+static fixed_point_t decay_coef[DECAY_HISTORY]; /* Decay for each second,
+                                                   indexed mod DECAY_HISTORY. */
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
@@ -70,6 +99,15 @@ static struct thread *next_thread_to_run (void);
 static void init_thread (struct thread *, const char *name, int priority);
 static bool is_thread (struct thread *) UNUSED;
 static void *alloc_frame (struct thread *, size_t size);
+static void ready_push (struct thread *);
+static void ready_remove (struct thread *);
+static void set_priority (struct thread *, int priority);
+static void mlfqs_tick (struct thread *);
+static void mlfqs_catch_up (struct thread *);
+static int mlfqs_priority (struct thread *);
+static int ready_max_priority (void);
+static void charge_time (struct thread *, unsigned long long *bucket);
+static void account_switch (struct thread *cur, struct thread *next);
 static void schedule (void);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
@@ -85,7 +123,7 @@ static tid_t allocate_tid (void);
    general and it is possible in this case only because loader.S
    was careful to put the bottom of the stack at a page boundary.
 
-   Also initializes the run queue and the tid lock.
+   Also initializes the run queues and the tid lock.
 
    After calling this function, be sure to initialize the page
    allocator before trying to create any threads with
@@ -96,10 +134,14 @@ static tid_t allocate_tid (void);
 void
 thread_init (void)
 {
+  int pri;
+
   ASSERT (intr_get_level () == INTR_OFF);
 
   lock_init (&tid_lock);
-  list_init (&ready_list);
+  for (pri = PRI_MIN; pri <= PRI_MAX; pri++)
+    list_init (&ready_queues[pri]);
+  ready_bitmap = 0;
   list_init (&all_list);
 
   /* Set up a thread structure for the running thread. */
@@ -143,6 +185,15 @@ thread_tick (void)
 #endif
   else
     kernel_ticks++;
+#ifdef USERPROG
+  if (t->pagedir != NULL)
+    t->stats.user_ticks++;
+  else
+#endif
+    t->stats.kernel_ticks++;
+
+  if (thread_mlfqs)
+    mlfqs_tick (t);
 
   /* Enforce preemption. */
   if (++thread_ticks >= TIME_SLICE)
@@ -157,6 +208,19 @@ thread_print_stats (void)
           idle_ticks, kernel_ticks, user_ticks);
 }
 
+/* Copies the running thread's statistics into STATS, charging
+   the current time slice so far as run time. */
+void
+thread_get_stats (struct thread_stats *stats)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level = intr_disable ();
+
+  *stats = cur->stats;
+  stats->run_cycles += rdtsc () - cur->state_tsc;
+  intr_set_level (old_level);
+}
+
 /* Creates a new kernel thread named NAME with the given initial
    PRIORITY, which executes FUNCTION passing AUX as the argument,
    and adds it to the ready queue.  Returns the thread identifier
@@ -169,9 +233,8 @@ thread_print_stats (void)
    scheduled.  Use a semaphore or some other form of
    synchronization if you need to ensure ordering.
 
-   The code provided sets the new thread's `priority' member to
-   PRIORITY, but no actual priority scheduling is implemented.
-   Priority scheduling is the goal of Problem 1-3. */
+   If the new thread's PRIORITY is higher than the running
+   thread's, the new thread runs before thread_create() returns. */
 tid_t
 thread_create (const char *name, int priority,
                thread_func *function, void *aux)
@@ -189,57 +252,39 @@ thread_create (const char *name, int priority,
   if (t == NULL)
     return TID_ERROR;
 
-  /* Initialize thread. */
+  /* Initialize thread.  Under the MLFQS scheduler, the new thread
+     inherits its creator's niceness and recent_cpu, and its
+     priority follows from those rather than from PRIORITY. */
   init_thread (t, name, priority);
   tid = t->tid = allocate_tid ();
-
-  /* Add pointers to the shared block in parent and child threads */
-  if (strcmp(name, "idle") == 0)
+  trace_thread_name (tid, name);
+  if (thread_mlfqs)
     {
-      t->shared = malloc(sizeof (struct shared_block));
-      t->shared->exit_status = -1;
-      t->shared->reference_count = 2;
-      sema_init(&t->shared->thread_finished, 0);
-      sema_init(&t->shared->thread_loaded, 0);
-      sema_init(&t->shared->ref_cnt_sema, 1);
-    }
-  else
-    {
-      t->shared = (struct shared_block *)aux;
+      struct thread *cur = thread_current ();
+      enum intr_level old_level = intr_disable ();
+      t->nice = cur->nice;
+      t->recent_cpu = cur->recent_cpu;
+      t->decay_epoch = cur->decay_epoch;
+      t->priority = t->base_priority = mlfqs_priority (t);
+      intr_set_level (old_level);
     }
 
-  t->shared->tid = t->tid;
-  list_push_back (&thread_current ()->children, &t->shared->child_elem);
-
   /* Initialize list of file_data for thread. */
   list_init (&t->file_data_list);
 
   // t->curr_dir = dir_open_root ();
+#ifdef FILESYS
   if (init_filesys && thread_current ()->curr_dir == NULL)
     t->curr_dir = dir_open_root ();
   else
+#endif
     t->curr_dir = thread_current ()->curr_dir;
 
   /* Stack frame for kernel_thread(). */
   kf = alloc_frame (t, sizeof *kf);
   kf->eip = NULL;
   kf->function = function;
-
-  if (strcmp(name, "idle") == 0)
-    {
-      kf->aux = aux;
-    }
-  else
-    {
-      char *fn_copy;
-      /* Make a copy of FILE_NAME.
-      Otherwise there's a race between the caller and load(). */
-      fn_copy = palloc_get_page (0);
-      if (fn_copy == NULL)
-        return TID_ERROR;
-      strlcpy (fn_copy, name, PGSIZE);
-      kf->aux = fn_copy;
-    }
+  kf->aux = aux;
 
   /* Stack frame for switch_entry(). */
   ef = alloc_frame (t, sizeof *ef);
@@ -252,6 +297,7 @@ thread_create (const char *name, int priority,
 
   /* Add to run queue. */
   thread_unblock (t);
+  thread_preempt ();
 
   return tid;
 }
@@ -268,6 +314,7 @@ thread_block (void)
   ASSERT (!intr_context ());
   ASSERT (intr_get_level () == INTR_OFF);
 
+  trace (TRACE_BLOCK, 0, 0);
   thread_current ()->status = THREAD_BLOCKED;
   schedule ();
 }
@@ -276,10 +323,12 @@ thread_block (void)
    This is an error if T is not blocked.  (Use thread_yield() to
    make the running thread ready.)
 
-   This function does not preempt the running thread.  This can
-   be important: if the caller had disabled interrupts itself,
-   it may expect that it can atomically unblock a thread and
-   update other data. */
+   This function does not preempt the running thread, even if T
+   has a higher priority.  This can be important: if the caller
+   had disabled interrupts itself, it may expect that it can
+   atomically unblock a thread and update other data.  Callers
+   that want T to run right away call thread_preempt()
+   afterward. */
 void
 thread_unblock (struct thread *t)
 {
@@ -289,8 +338,15 @@ thread_unblock (struct thread *t)
 
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
-  list_push_back (&ready_list, &t->elem);
+  if (thread_mlfqs)
+    {
+      mlfqs_catch_up (t);
+      t->priority = mlfqs_priority (t);
+    }
+  charge_time (t, &t->stats.blocked_cycles);
+  ready_push (t);
   t->status = THREAD_READY;
+  trace (TRACE_UNBLOCK, t->tid, 0);
   intr_set_level (old_level);
 }
 
@@ -360,12 +416,31 @@ thread_yield (void)
 
   old_level = intr_disable ();
   if (cur != idle_thread)
-    list_push_back (&ready_list, &cur->elem);
+    ready_push (cur);
   cur->status = THREAD_READY;
   schedule ();
   intr_set_level (old_level);
 }
 
+/* Yields the CPU if a thread with a higher priority than the
+   running thread is ready.  In an interrupt handler, the yield
+   happens just before the interrupt returns.  Called after
+   waking a thread or lowering the running thread's priority. */
+void
+thread_preempt (void)
+{
+  enum intr_level old_level = intr_disable ();
+  bool preempt = ready_max_priority () > thread_current ()->priority;
+  intr_set_level (old_level);
+
+  if (!preempt)
+    return;
+  if (intr_context ())
+    intr_yield_on_return ();
+  else
+    thread_yield ();
+}
+
 /* Invoke function 'func' on all threads, passing along 'aux'.
    This function must be called with interrupts off. */
 void
@@ -383,11 +458,96 @@ thread_foreach (thread_action_func *func, void *aux)
     }
 }
 
-/* Sets the current thread's priority to NEW_PRIORITY. */
+/* Sets the current thread's base priority to NEW_PRIORITY,
+   yielding if it is no longer the highest.  Priority donated to
+   the thread still applies until it releases the locks that
+   brought it.  Ignored under the MLFQS scheduler, which sets
+   priorities itself. */
 void
 thread_set_priority (int new_priority)
 {
-  thread_current ()->priority = new_priority;
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (PRI_MIN <= new_priority && new_priority <= PRI_MAX);
+  if (thread_mlfqs)
+    return;
+
+  old_level = intr_disable ();
+  cur->base_priority = new_priority;
+  thread_update_priority (cur);
+  intr_set_level (old_level);
+  thread_preempt ();
+}
+
+/* Raises T's priority to PRIORITY, if that is higher, on behalf
+   of a thread waiting for a lock T holds.  Must be called with
+   interrupts off. */
+void
+thread_donate_priority (struct thread *t, int priority)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (is_thread (t));
+
+  if (priority > t->priority)
+    set_priority (t, priority);
+}
+
+/* Recomputes T's priority as the highest of its base priority
+   and the priorities of the threads waiting for locks T holds.
+   Called when T releases a lock or changes its base priority.
+   Must be called with interrupts off. */
+void
+thread_update_priority (struct thread *t)
+{
+  int priority = t->base_priority;
+  struct list_elem *le, *we;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (is_thread (t));
+
+  for (le = list_begin (&t->held_locks); le != list_end (&t->held_locks);
+       le = list_next (le))
+    {
+      struct lock *lock = list_entry (le, struct lock, elem);
+      struct list *waiters = &lock->semaphore.waiters;
+
+      for (we = list_begin (waiters); we != list_end (waiters);
+           we = list_next (we))
+        {
+          struct thread *w = list_entry (we, struct thread, elem);
+          if (w->priority > priority)
+            priority = w->priority;
+        }
+    }
+  set_priority (t, priority);
+}
+
+/* Returns true if the thread with list element A has lower
+   priority than the one with B.  For list_max(), which then
+   picks the earliest of several threads with the same
+   priority. */
+bool
+thread_priority_less (const struct list_elem *a,
+                      const struct list_elem *b, void *aux UNUSED)
+{
+  return (list_entry (a, struct thread, elem)->priority
+          < list_entry (b, struct thread, elem)->priority);
+}
+
+/* Sets T's priority to PRIORITY, moving it to the matching run
+   queue if it is ready.  Must be called with interrupts off. */
+static void
+set_priority (struct thread *t, int priority)
+{
+  if (t->status == THREAD_READY && t != idle_thread)
+    {
+      ready_remove (t);
+      t->priority = priority;
+      ready_push (t);
+    }
+  else
+    t->priority = priority;
 }
 
 /* Returns the current thread's priority. */
@@ -397,35 +557,161 @@ thread_get_priority (void)
   return thread_current ()->priority;
 }
 
-/* Sets the current thread's nice value to NICE. */
+/* Sets the current thread's nice value to NICE, recomputes its
+   priority, and yields if it is no longer the highest. */
 void
-thread_set_nice (int nice UNUSED)
+thread_set_nice (int nice)
 {
-  /* Not yet implemented. */
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  if (nice < NICE_MIN)
+    nice = NICE_MIN;
+  else if (nice > NICE_MAX)
+    nice = NICE_MAX;
+
+  old_level = intr_disable ();
+  cur->nice = nice;
+  if (thread_mlfqs)
+    set_priority (cur, mlfqs_priority (cur));
+  intr_set_level (old_level);
+  thread_preempt ();
 }
 
 /* Returns the current thread's nice value. */
 int
 thread_get_nice (void)
 {
-  /* Not yet implemented. */
-  return 0;
+  return thread_current ()->nice;
 }
 
 /* Returns 100 times the system load average. */
 int
 thread_get_load_avg (void)
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int load = fix_round (fix_scale (load_avg, 100));
+  intr_set_level (old_level);
+  return load;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int
 thread_get_recent_cpu (void)
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  struct thread *cur = thread_current ();
+  int recent_cpu;
+
+  mlfqs_catch_up (cur);
+  recent_cpu = fix_round (fix_scale (cur->recent_cpu, 100));
+  intr_set_level (old_level);
+  return recent_cpu;
+}
+
+/* Returns T's MLFQS priority, computed from its recent_cpu and
+   niceness as PRI_MAX - recent_cpu / 4 - nice * 2, clamped to the
+   valid range. */
+static int
+mlfqs_priority (struct thread *t)
+{
+  int priority = PRI_MAX - fix_trunc (fix_unscale (t->recent_cpu, 4))
+                 - t->nice * 2;
+
+  if (priority < PRI_MIN)
+    return PRI_MIN;
+  else if (priority > PRI_MAX)
+    return PRI_MAX;
+  return priority;
+}
+
+/* Applies to T's recent_cpu the once-a-second decays it has
+   missed since it last ran or was ready.  The coefficients of
+   decays more than DECAY_HISTORY seconds old are no longer
+   known, so those steps, nice term included, are skipped, as if
+   recent_cpu had stayed put.  The error that leaves is scaled by
+   the product of the DECAY_HISTORY coefficients applied after
+   them, which is negligible unless load_avg is very high.  Must
+   be called with interrupts off. */
+static void
+mlfqs_catch_up (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (decay_seconds - t->decay_epoch > DECAY_HISTORY)
+    t->decay_epoch = decay_seconds - DECAY_HISTORY;
+  for (; t->decay_epoch != decay_seconds; t->decay_epoch++)
+    t->recent_cpu = fix_add (fix_mul (decay_coef[t->decay_epoch
+                                                 % DECAY_HISTORY],
+                                      t->recent_cpu),
+                             fix_int (t->nice));
+}
+
+/* Once a second: updates load_avg, then decays the recent_cpu of
+   and recomputes the priority of CUR and every ready thread.
+   Blocked threads are left for mlfqs_catch_up(). */
+static void
+mlfqs_decay (struct thread *cur)
+{
+  struct list ready;
+  int ready_threads = ready_cnt + (cur != idle_thread);
+  fixed_point_t twice_load;
+  int pri;
+
+  load_avg = fix_add (fix_mul (fix_frac (59, 60), load_avg),
+                      fix_scale (fix_frac (1, 60), ready_threads));
+  twice_load = fix_scale (load_avg, 2);
+  decay_coef[decay_seconds % DECAY_HISTORY]
+    = fix_div (twice_load, fix_add (twice_load, fix_int (1)));
+  decay_seconds++;
+
+  if (cur != idle_thread)
+    {
+      mlfqs_catch_up (cur);
+      cur->priority = mlfqs_priority (cur);
+    }
+
+  /* Requeue the ready threads, highest priority first so that
+     threads that stay in the same queue keep their order. */
+  list_init (&ready);
+  for (pri = PRI_MAX; pri >= PRI_MIN; pri--)
+    while (!list_empty (&ready_queues[pri]))
+      list_push_back (&ready, list_pop_front (&ready_queues[pri]));
+  ready_bitmap = 0;
+  ready_cnt = 0;
+  while (!list_empty (&ready))
+    {
+      struct thread *t = list_entry (list_pop_front (&ready),
+                                     struct thread, elem);
+      mlfqs_catch_up (t);
+      t->priority = mlfqs_priority (t);
+      ready_push (t);
+    }
+}
+
+/* MLFQS accounting for a timer tick in which CUR was running.
+   Runs in an external interrupt context. */
+static void
+mlfqs_tick (struct thread *cur)
+{
+  int64_t ticks = timer_ticks ();
+
+  if (cur != idle_thread)
+    cur->recent_cpu = fix_add (cur->recent_cpu, fix_int (1));
+
+  if (ticks % TIMER_FREQ == 0)
+    mlfqs_decay (cur);
+  else if (ticks % PRIORITY_TICKS == 0 && cur != idle_thread)
+    {
+      /* Only the running thread's recent_cpu has changed since
+         the last update, so no other priority can have. */
+      cur->priority = mlfqs_priority (cur);
+    }
+  else
+    return;
+
+  if (ready_max_priority () > cur->priority)
+    intr_yield_on_return ();
 }
 
 /*
@@ -477,6 +763,7 @@ idle (void *idle_started_ UNUSED)
 
          See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
          7.11.1 "HLT Instruction". */
+      timer_idle_enter ();
       asm volatile ("sti; hlt" : : : "memory");
     }
 }
@@ -528,9 +815,11 @@ init_thread (struct thread *t, const char *name, int priority)
   t->status = THREAD_BLOCKED;
   strlcpy (t->name, name, sizeof t->name);
   t->stack = (uint8_t *) t + PGSIZE;
-  t->priority = priority;
+  t->priority = t->base_priority = priority;
+  list_init (&t->held_locks);
   // t->curr_dir = thread_current ()->curr_dir;
   t->magic = THREAD_MAGIC;
+  t->state_tsc = rdtsc ();
 
   /* Initializes this thread's children list. */
   list_init(&t->children);
@@ -553,18 +842,81 @@ alloc_frame (struct thread *t, size_t size)
   return t->stack;
 }
 
+/* Adds T to the back of the run queue for its priority.  Must be
+   called with interrupts off. */
+static void
+ready_push (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+  list_push_back (&ready_queues[t->priority], &t->elem);
+  ready_bitmap |= (uint64_t) 1 << (PRI_MAX - t->priority);
+  ready_cnt++;
+}
+
+/* Removes ready thread T from its run queue.  Must be called
+   with interrupts off. */
+static void
+ready_remove (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->status == THREAD_READY);
+
+  list_remove (&t->elem);
+  ready_cnt--;
+  if (list_empty (&ready_queues[t->priority]))
+    ready_bitmap &= ~((uint64_t) 1 << (PRI_MAX - t->priority));
+}
+
+/* Returns the index of the lowest set bit in nonzero WORD. */
+static inline int
+lowest_bit (uint32_t word)
+{
+  int bit;
+  asm ("bsf %1, %0" : "=r" (bit) : "rm" (word));
+  return bit;
+}
+
+/* Returns the priority of the highest-priority ready thread, or
+   PRI_MIN - 1 if no thread is ready.  Must be called with
+   interrupts off. */
+static int
+ready_max_priority (void)
+{
+  uint32_t lo = ready_bitmap;
+  uint32_t hi = ready_bitmap >> 32;
+
+  if (lo != 0)
+    return PRI_MAX - lowest_bit (lo);
+  else if (hi != 0)
+    return PRI_MAX - 32 - lowest_bit (hi);
+  else
+    return PRI_MIN - 1;
+}
+
 /* Chooses and returns the next thread to be scheduled.  Should
    return a thread from the run queue, unless the run queue is
    empty.  (If the running thread can continue running, then it
    will be in the run queue.)  If the run queue is empty, return
-   idle_thread. */
+   idle_thread.
+
+   Takes the first thread in the highest-priority nonempty queue,
+   so threads of equal priority take turns round-robin. */
 static struct thread *
 next_thread_to_run (void)
 {
-  if (list_empty (&ready_list))
+  int pri = ready_max_priority ();
+  struct thread *t;
+
+  if (pri < PRI_MIN)
     return idle_thread;
-  else
-    return list_entry (list_pop_front (&ready_list), struct thread, elem);
+
+  t = list_entry (list_pop_front (&ready_queues[pri]), struct thread, elem);
+  ready_cnt--;
+  if (list_empty (&ready_queues[pri]))
+    ready_bitmap &= ~((uint64_t) 1 << (PRI_MAX - pri));
+  return t;
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -613,6 +965,33 @@ thread_schedule_tail (struct thread *prev)
     }
 }
 
+/* Adds the time since T's status last changed to *BUCKET, one of
+   T's stats, and restarts the clock for T's next status. */
+static void
+charge_time (struct thread *t, unsigned long long *bucket)
+{
+  uint64_t now = rdtsc ();
+
+  *bucket += now - t->state_tsc;
+  t->state_tsc = now;
+}
+
+/* Accounts for a switch from CUR, whose status has already been
+   changed, to NEXT: CUR has been running, NEXT has been waiting
+   in the ready queue.  A switch away from a thread that is still
+   ready to run (it was preempted or yielded) is involuntary; one
+   away from a thread that blocked is voluntary. */
+static void
+account_switch (struct thread *cur, struct thread *next)
+{
+  charge_time (cur, &cur->stats.run_cycles);
+  charge_time (next, &next->stats.ready_cycles);
+  if (cur->status == THREAD_READY)
+    cur->stats.involuntary_switches++;
+  else if (cur->status == THREAD_BLOCKED)
+    cur->stats.voluntary_switches++;
+}
+
 /* Schedules a new process.  At entry, interrupts must be off and
    the running process's state must have been changed from
    running to some other state.  This function finds another
@@ -632,7 +1011,11 @@ schedule (void)
   ASSERT (is_thread (next));
 
   if (cur != next)
-    prev = switch_threads (cur, next);
+    {
+      account_switch (cur, next);
+      trace (TRACE_SWITCH, next->tid, cur->status);
+      prev = switch_threads (cur, next);
+    }
   thread_schedule_tail (prev);
 }
 
@@ -4,6 +4,7 @@
 #include <debug.h>
 #include <list.h>
 #include <stdint.h>
+#include <thread-stats.h>
 #include "threads/synch.h"
 #include "threads/fixed-point.h"
 
@@ -26,6 +27,11 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* Thread niceness, for the MLFQS scheduler. */
+#define NICE_MIN -20                    /* Nicest to other threads. */
+#define NICE_DEFAULT 0                  /* Default niceness. */
+#define NICE_MAX 20                     /* Least nice. */
+
 /* A kernel thread or user process.
 
    Each thread structure is stored in its own 4 kB page.  The
@@ -111,6 +117,9 @@ struct shared_block
 
   //necessary for threads to be able to have a list of their thread's child shared_block
   struct list_elem child_elem;
+
+  // command line for the child to load; allocated along with the struct
+  char cmd_line[];
 };
 
 struct thread
@@ -124,9 +133,18 @@ struct thread
     enum thread_status status;          /* Thread state. */
     char name[16];                      /* Name (for debugging purposes). */
     uint8_t *stack;                     /* Saved stack pointer. */
-    int priority;                       /* Priority. */
+    int priority;                       /* Priority, including donations. */
+    int base_priority;                  /* Priority before donations. */
+    int nice;                           /* MLFQS niceness. */
+    fixed_point_t recent_cpu;           /* MLFQS recent CPU time. */
+    unsigned decay_epoch;               /* Seconds applied to recent_cpu. */
     struct list_elem allelem;           /* List element for all threads list. */
 
+    /* Accounting.  thread.c keeps the times, ticks, and switch
+       counts; userprog/syscall.c counts system calls. */
+    struct thread_stats stats;          /* See lib/thread-stats.h. */
+    uint64_t state_tsc;                 /* TSC when status last changed. */
+
     /* File operation syscalls. */
     struct file *executable;            /* Pointer to thread's executable file. */
     struct list file_data_list;         /* List of file_data for current thread. */
@@ -135,10 +153,21 @@ struct thread
 
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
+    struct list held_locks;             /* Locks held, for donation. */
+    struct lock *waiting_lock;          /* Lock being acquired, if any. */
 
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
+#ifdef VM
+    /* Owned by vm/page.c. */
+    struct hash *pages;                 /* Supplemental page table. */
+    void *user_esp;                     /* User stack pointer, saved on
+                                           entry to the kernel. */
+
+    /* Owned by userprog/syscall.c. */
+    struct list mappings;               /* Memory-mapped files. */
+#endif
 #endif
 
     /* Owned by thread.c. */
@@ -150,7 +179,6 @@ struct file_data
   {
 	  int fd;                     /* File descriptor number. */
     bool is_directory;
-	  const char *file_name;      /* File name. */
 	  struct file *file_p;        /* Pointer to the file struct. */
     struct dir *dir_p;          /* Pointer to the dir struct. */
 	  struct list_elem elem;      /* List element for file_data_list. */
@@ -161,11 +189,16 @@ struct file_data
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, print each user process's thread_stats when it exits.
+   Controlled by kernel command-line option "-tstats". */
+extern bool thread_exit_stats;
+
 void thread_init (void);
 void thread_start (void);
 
 void thread_tick (void);
 void thread_print_stats (void);
+void thread_get_stats (struct thread_stats *);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
@@ -179,6 +212,7 @@ const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
+void thread_preempt (void);
 
 /* Performs some operation on thread t, given auxiliary data AUX. */
 typedef void thread_action_func (struct thread *t, void *aux);
@@ -186,6 +220,10 @@ void thread_foreach (thread_action_func *, void *);
 
 int thread_get_priority (void);
 void thread_set_priority (int);
+void thread_donate_priority (struct thread *, int);
+void thread_update_priority (struct thread *);
+bool thread_priority_less (const struct list_elem *,
+                           const struct list_elem *, void *aux);
 
 struct dir *thread_get_dir(void);
 
@@ -0,0 +1,162 @@
+#include "threads/trace.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/cpu.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+/* Number of events kept in the ring buffer.  Must be a power of
+   2.  At 24 bytes per event this is 24 pages, allocated only
+   when tracing is enabled. */
+#define TRACE_EVENT_CNT 4096
+
+/* Number of thread names remembered, indexed by tid modulo this
+   count.  Names of threads whose slots have been reused by a
+   later thread are lost. */
+#define TRACE_NAME_CNT 256
+
+/* Ring buffer, or a null pointer if tracing is off. */
+struct trace_event *trace_buf;
+
+/* Number of events ever recorded.  The next event goes into
+   trace_buf[trace_head % TRACE_EVENT_CNT]. */
+static uint32_t trace_head;
+
+/* Thread names. */
+struct trace_name
+  {
+    int tid;
+    char name[16];
+  };
+static struct trace_name trace_names[TRACE_NAME_CNT];
+
+/* TSC and timer ticks when tracing started, or when the timer
+   frequency last changed, to calibrate the TSC rate against the
+   timer. */
+static uint64_t start_tsc;
+static int64_t start_ticks;
+
+/* Names of event types, as printed by trace_print(). */
+static const char *trace_type_names[TRACE_TYPE_CNT] =
+  {
+    "switch", "block", "unblock", "lock-wait",
+    "intr-enter", "intr-exit", "syscall-enter", "syscall-exit",
+  };
+
+/* Atomically adds 1 to *P and returns its old value. */
+static inline uint32_t
+fetch_and_inc (uint32_t *p)
+{
+  uint32_t old = 1;
+  asm volatile ("lock xaddl %0, %1" : "+r" (old), "+m" (*p) : : "memory");
+  return old;
+}
+
+/* Allocates the ring buffer and starts recording events.  Called
+   once at boot, after the page allocator is ready, if the kernel
+   was started with "-trace". */
+void
+trace_init (void)
+{
+  size_t page_cnt = DIV_ROUND_UP (TRACE_EVENT_CNT * sizeof *trace_buf,
+                                  PGSIZE);
+
+  ASSERT (trace_buf == NULL);
+
+  trace_calibrate ();
+  trace_thread_name (thread_tid (), thread_name ());
+  trace_buf = palloc_get_multiple (PAL_ASSERT, page_cnt);
+}
+
+/* Restarts the calibration of the TSC rate against the timer.
+   timer_set_freq() calls this, since ticks counted at the old
+   frequency would skew the rate that trace_print() reports. */
+void
+trace_calibrate (void)
+{
+  start_tsc = rdtsc ();
+  start_ticks = timer_ticks ();
+}
+
+/* Records an event of the given TYPE with arguments ARG0 and ARG1
+   in the ring buffer, overwriting the oldest event if it is full.
+
+   Does not disable interrupts: each event claims its own slot
+   with a single atomic increment, so an interrupt handler that
+   records events while another event is half-written fills
+   different slots.  As a result, events can land in the buffer
+   slightly out of timestamp order; utils/pintos-trace sorts
+   them. */
+void
+trace_record (enum trace_type type, uint32_t arg0, uint32_t arg1)
+{
+  struct trace_event *e;
+  struct thread *t;
+
+  ASSERT (type < TRACE_TYPE_CNT);
+
+  /* Find the running thread the way running_thread() does.
+     thread_current() would assert that its status is
+     THREAD_RUNNING, which is not true in schedule(). */
+  t = pg_round_down (&e);
+
+  e = &trace_buf[fetch_and_inc (&trace_head) % TRACE_EVENT_CNT];
+  e->tsc = rdtsc ();
+  e->tid = t->tid;
+  e->type = type;
+  e->arg0 = arg0;
+  e->arg1 = arg1;
+}
+
+/* Remembers NAME as the name of thread TID, so that trace_print()
+   can label its events. */
+void
+trace_thread_name (int tid, const char *name)
+{
+  struct trace_name *n = &trace_names[tid % TRACE_NAME_CNT];
+
+  n->tid = tid;
+  strlcpy (n->name, name, sizeof n->name);
+}
+
+/* Prints the contents of the trace buffer, oldest event first,
+   in the format read by utils/pintos-trace, and stops tracing.
+   Does nothing if tracing is off. */
+void
+trace_print (void)
+{
+  struct trace_event *buf = trace_buf;
+  uint32_t head = trace_head;
+  uint32_t first = head > TRACE_EVENT_CNT ? head - TRACE_EVENT_CNT : 0;
+  uint64_t tsc_hz = 0;
+  int64_t ticks;
+  uint32_t i;
+
+  if (buf == NULL)
+    return;
+
+  /* Stop recording, so that printing doesn't trace itself. */
+  trace_buf = NULL;
+
+  ticks = timer_ticks () - start_ticks;
+  if (ticks > 0)
+    tsc_hz = (rdtsc () - start_tsc) * TIMER_FREQ / ticks;
+
+  printf ("trace: begin tsc_hz=%"PRIu64" events=%"PRIu32" lost=%"PRIu32"\n",
+          tsc_hz, head - first, first);
+  for (i = 0; i < TRACE_NAME_CNT; i++)
+    if (trace_names[i].tid != 0)
+      printf ("trace: name %d %s\n", trace_names[i].tid, trace_names[i].name);
+  for (i = first; i != head; i++)
+    {
+      const struct trace_event *e = &buf[i % TRACE_EVENT_CNT];
+      printf ("trace: %"PRIu64" %d %s %"PRIu32" %"PRIu32"\n",
+              e->tsc, e->tid, trace_type_names[e->type], e->arg0, e->arg1);
+    }
+  printf ("trace: end\n");
+}
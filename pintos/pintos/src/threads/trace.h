@@ -0,0 +1,71 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Kernel event tracing.
+
+   When the kernel is booted with "-trace", scheduler,
+   synchronization, interrupt, and system call events are
+   recorded, timestamped with the TSC, into a fixed-size ring
+   buffer that keeps the most recent events.  At power off the
+   buffer is printed to the console, and utils/pintos-trace
+   converts that output to Chrome trace JSON (for
+   chrome://tracing or Perfetto).
+
+   Recording an event costs a test of trace_buf when tracing is
+   off, and an RDTSC plus one atomic increment when it is on, so
+   the hooks may stay in hot paths and in interrupt handlers. */
+
+/* Event types.  Keep trace_type_names[] in trace.c, and
+   utils/pintos-trace, in sync. */
+enum trace_type
+  {
+    TRACE_SWITCH,               /* Switched to thread ARG0; ARG1 is
+                                   the old thread's new status. */
+    TRACE_BLOCK,                /* Thread blocked. */
+    TRACE_UNBLOCK,              /* Thread unblocked thread ARG0. */
+    TRACE_LOCK_WAIT,            /* Acquired lock ARG0 after waiting
+                                   ARG1 TSC cycles for it. */
+    TRACE_INTR_ENTER,           /* Entered handler for vector ARG0. */
+    TRACE_INTR_EXIT,            /* Left handler for vector ARG0. */
+    TRACE_SYSCALL_ENTER,        /* Began system call ARG0. */
+    TRACE_SYSCALL_EXIT,         /* Finished system call ARG0. */
+    TRACE_TYPE_CNT
+  };
+
+/* One recorded event. */
+struct trace_event
+  {
+    uint64_t tsc;               /* Time stamp counter. */
+    int tid;                    /* Running thread. */
+    uint32_t type;              /* An enum trace_type. */
+    uint32_t arg0, arg1;        /* Type-specific arguments. */
+  };
+
+/* Ring buffer, or a null pointer if tracing is off. */
+extern struct trace_event *trace_buf;
+
+void trace_init (void);
+void trace_calibrate (void);
+void trace_record (enum trace_type, uint32_t arg0, uint32_t arg1);
+void trace_thread_name (int tid, const char *name);
+void trace_print (void);
+
+/* Records an event of the given TYPE, if tracing is on. */
+static inline void
+trace (enum trace_type type, uint32_t arg0, uint32_t arg1)
+{
+  if (trace_buf != NULL)
+    trace_record (type, arg0, arg1);
+}
+
+static inline bool
+trace_enabled (void)
+{
+  return trace_buf != NULL;
+}
+
+#endif /* threads/trace.h */
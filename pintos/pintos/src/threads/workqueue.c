@@ -0,0 +1,239 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Number of worker threads, and so the most work functions that
+   run at once. */
+#define WORKER_CNT 2
+
+/* Queued work that no worker has started, oldest first.
+   Protected by disabling interrupts, since work may be queued
+   from interrupt handlers. */
+static struct list pending_list;
+
+/* Counts the elements of pending_list, plus work cancelled since
+   it was queued.  Workers sleep on it. */
+static struct semaphore pending_sema;
+
+/* Amount of work queued or running.  workqueue_flush() waits for
+   it to drop to 0.  Protected by disabling interrupts. */
+static int busy_cnt;
+
+/* Threads waiting in workqueue_flush(). */
+static struct list flush_list;
+
+/* A thread waiting in workqueue_flush(). */
+struct flush_waiter
+  {
+    struct list_elem elem;      /* Element in flush_list. */
+    struct semaphore done;      /* Upped when busy_cnt reaches 0. */
+  };
+
+static thread_func worker NO_RETURN;
+static void work_done (void);
+static void delayed_work_expire (struct timer *, void *dw_);
+
+/* Starts the worker threads.  Must be called after
+   thread_start(), and before any work is queued. */
+void
+workqueue_init (void)
+{
+  int i;
+
+  list_init (&pending_list);
+  list_init (&flush_list);
+  sema_init (&pending_sema, 0);
+
+  for (i = 0; i < WORKER_CNT; i++)
+    {
+      char name[16];
+
+      snprintf (name, sizeof name, "worker%d", i);
+      if (thread_create (name, PRI_DEFAULT, worker, NULL) == TID_ERROR)
+        PANIC ("could not create %s thread", name);
+    }
+}
+
+/* Initializes WORK to call FUNC, passing AUX, when it runs. */
+void
+work_init (struct work *work, work_func *func, void *aux)
+{
+  ASSERT (work != NULL);
+  ASSERT (func != NULL);
+
+  work->func = func;
+  work->aux = aux;
+  work->pending = false;
+}
+
+/* Queues WORK to be run by a worker thread.  Returns true if
+   successful, false if WORK was already pending, in which case
+   it still runs only once.  May be called from interrupt
+   context. */
+bool
+work_queue (struct work *work)
+{
+  enum intr_level old_level = intr_disable ();
+  bool queued = !work->pending;
+
+  if (queued)
+    {
+      work->pending = true;
+      list_push_back (&pending_list, &work->elem);
+      busy_cnt++;
+      sema_up (&pending_sema);
+    }
+  intr_set_level (old_level);
+  return queued;
+}
+
+/* Removes WORK from the queue.  Returns true if it was pending,
+   false if it had already started or was never queued.  Does not
+   wait for a running work function to finish. */
+bool
+work_cancel (struct work *work)
+{
+  enum intr_level old_level = intr_disable ();
+  bool was_pending = work->pending;
+
+  if (was_pending)
+    {
+      list_remove (&work->elem);
+      work->pending = false;
+      work_done ();
+    }
+  intr_set_level (old_level);
+  return was_pending;
+}
+
+/* Initializes DW to call FUNC, passing AUX, when it runs. */
+void
+delayed_work_init (struct delayed_work *dw, work_func *func, void *aux)
+{
+  work_init (&dw->work, func, aux);
+  timer_setup (&dw->timer, delayed_work_expire, dw);
+}
+
+/* Queues DW's work once TICKS timer ticks have passed, or at
+   once if TICKS <= 0.  Returns true if successful, false if DW
+   was already waiting for its timer or pending.  May be called
+   from interrupt context, and from DW's own function to run it
+   periodically. */
+bool
+work_queue_delayed (struct delayed_work *dw, int64_t ticks)
+{
+  enum intr_level old_level;
+  bool queued;
+
+  if (ticks <= 0)
+    return work_queue (&dw->work);
+
+  old_level = intr_disable ();
+  queued = !dw->work.pending && !timer_pending (&dw->timer);
+  if (queued)
+    timer_add (&dw->timer, timer_ticks () + ticks);
+  intr_set_level (old_level);
+  return queued;
+}
+
+/* Cancels DW, whether it is waiting for its timer or queued.
+   Returns true if it was either, false otherwise.  Does not
+   wait for a running work function to finish. */
+bool
+work_cancel_delayed (struct delayed_work *dw)
+{
+  bool was_timer = timer_cancel (&dw->timer);
+  bool was_pending = work_cancel (&dw->work);
+
+  return was_timer || was_pending;
+}
+
+/* Waits until no work is queued or running, including work
+   queued while waiting.  Delayed work that is still waiting for
+   its timer is not waited for.  Must not be called from a work
+   function, which would wait for itself. */
+void
+workqueue_flush (void)
+{
+  struct flush_waiter w;
+  enum intr_level old_level;
+
+  ASSERT (!intr_context ());
+
+  sema_init (&w.done, 0);
+  old_level = intr_disable ();
+  if (busy_cnt > 0)
+    {
+      list_push_back (&flush_list, &w.elem);
+      intr_set_level (old_level);
+      sema_down (&w.done);
+    }
+  else
+    intr_set_level (old_level);
+}
+
+/* Worker thread.  Runs queued work, one at a time, forever. */
+static void
+worker (void *aux UNUSED)
+{
+  for (;;)
+    {
+      struct work *work = NULL;
+      enum intr_level old_level;
+
+      sema_down (&pending_sema);
+
+      /* The list can be empty if the work that upped the
+         semaphore was cancelled. */
+      old_level = intr_disable ();
+      if (!list_empty (&pending_list))
+        {
+          work = list_entry (list_pop_front (&pending_list),
+                             struct work, elem);
+          work->pending = false;
+        }
+      intr_set_level (old_level);
+
+      if (work != NULL)
+        {
+          /* WORK may be requeued or freed as soon as its function
+             starts, so don't touch it afterward. */
+          work->func (work, work->aux);
+
+          old_level = intr_disable ();
+          work_done ();
+          intr_set_level (old_level);
+        }
+    }
+}
+
+/* Accounts for one piece of work finishing or being cancelled,
+   waking up flushers if there is none left.  Must be called with
+   interrupts off. */
+static void
+work_done (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (busy_cnt > 0);
+
+  if (--busy_cnt == 0)
+    while (!list_empty (&flush_list))
+      {
+        struct flush_waiter *w = list_entry (list_pop_front (&flush_list),
+                                             struct flush_waiter, elem);
+        sema_up (&w->done);
+      }
+}
+
+/* Timer function for delayed work: queues DW_'s work. */
+static void
+delayed_work_expire (struct timer *timer UNUSED, void *dw_)
+{
+  struct delayed_work *dw = dw_;
+
+  work_queue (&dw->work);
+}
@@ -0,0 +1,53 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "devices/timer.h"
+
+/* Work queue.
+
+   Work is a function call deferred to one of a small, fixed pool
+   of kernel worker threads.  Unlike a timer or softirq function,
+   a work function runs in ordinary thread context, so it may
+   sleep, take locks, and do I/O.  This lets code that must not
+   sleep, such as interrupt handlers and timer functions, hand
+   off slow jobs, and lets subsystems run background jobs without
+   a thread of their own.
+
+   Work runs in the order it was queued, at most WORKER_CNT
+   functions at a time.  The owner keeps the struct work alive
+   while it is pending; once its function has started, the work
+   may be queued again, or freed, including by the function
+   itself. */
+struct work;
+typedef void work_func (struct work *, void *aux);
+
+struct work
+  {
+    struct list_elem elem;      /* Element in the pending list. */
+    work_func *func;            /* Function to call. */
+    void *aux;                  /* Auxiliary data for FUNC. */
+    bool pending;               /* Queued and not yet started? */
+  };
+
+/* Work queued once a number of timer ticks have passed. */
+struct delayed_work
+  {
+    struct work work;           /* The work to queue. */
+    struct timer timer;         /* Queues WORK when it expires. */
+  };
+
+void workqueue_init (void);
+void workqueue_flush (void);
+
+void work_init (struct work *, work_func *, void *aux);
+bool work_queue (struct work *);
+bool work_cancel (struct work *);
+
+void delayed_work_init (struct delayed_work *, work_func *, void *aux);
+bool work_queue_delayed (struct delayed_work *, int64_t ticks);
+bool work_cancel_delayed (struct delayed_work *);
+
+#endif /* threads/workqueue.h */
@@ -5,6 +5,10 @@
 #include "userprog/gdt.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
@@ -148,9 +152,32 @@ page_fault (struct intr_frame *f)
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
-  /* To implement virtual memory, delete the rest of the function
-     body, and replace it with code that brings in the page to
-     which fault_addr refers. */
+#ifdef VM
+  /* A fault in user code has the user stack pointer in F.  One in
+     the kernel, e.g. in a system call, relies on the copy saved
+     by syscall_handler(). */
+  if (user)
+    thread_current ()->user_esp = f->esp;
+
+  /* Let the pager bring in the page, if it is one that the
+     process may access, growing the stack if needed.  This
+     covers faults by the kernel on user addresses, too, e.g.
+     while a system call copies data. */
+  if (not_present && is_user_vaddr (fault_addr) && page_in (fault_addr))
+    return;
+#endif
+
+  /* A bad user pointer passed to a system call: return -1 from
+     get_user() or put_user(), which left the address to resume at
+     in EAX. */
+  if (!user && ((const char *) f->eip == get_user_insn
+                || (const char *) f->eip == put_user_insn))
+    {
+      f->eip = (void (*) (void)) f->eax;
+      f->eax = 0xffffffff;
+      return;
+    }
+
   char *save_ptr;
   char *name = strtok_r ((char *) &thread_current ()->name, " ", &save_ptr);
   printf ("%s: exit(%d)\n", name, -1);
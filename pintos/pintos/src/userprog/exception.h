@@ -6,6 +6,11 @@
 #define PF_W 0x2    /* 0: read, 1: write. */
 #define PF_U 0x4    /* 0: kernel, 1: user process. */
 
+/* Instructions in get_user() and put_user(), in
+   userprog/syscall.c, that access user memory on behalf of the
+   kernel and may fault on a bad user pointer. */
+extern const char get_user_insn[], put_user_insn[];
+
 void exception_init (void);
 void exception_print_stats (void);
 
@@ -7,7 +7,7 @@
 #include "threads/palloc.h"
 
 static uint32_t *active_pd (void);
-static void invalidate_pagedir (uint32_t *);
+static void invalidate_page (uint32_t *, const void *);
 
 /* Creates a new page directory that has mappings for kernel
    virtual addresses, but none for user virtual addresses.
@@ -152,7 +152,7 @@ pagedir_clear_page (uint32_t *pd, void *upage)
   if (pte != NULL && (*pte & PTE_P) != 0)
     {
       *pte &= ~PTE_P;
-      invalidate_pagedir (pd);
+      invalidate_page (pd, upage);
     }
 }
 
@@ -180,7 +180,7 @@ pagedir_set_dirty (uint32_t *pd, const void *vpage, bool dirty)
       else
         {
           *pte &= ~(uint32_t) PTE_D;
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
         }
     }
 }
@@ -209,7 +209,7 @@ pagedir_set_accessed (uint32_t *pd, const void *vpage, bool accessed)
       else
         {
           *pte &= ~(uint32_t) PTE_A;
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
         }
     }
 }
@@ -224,9 +224,10 @@ pagedir_activate (uint32_t *pd)
 
   /* Store the physical address of the page directory into CR3
      aka PDBR (page directory base register).  This activates our
-     new page tables immediately.  See [IA32-v2a] "MOV--Move
-     to/from Control Registers" and [IA32-v3a] 3.7.5 "Base
-     Address of the Page Directory". */
+     new page tables immediately, flushing the TLB of everything
+     but the kernel's global mappings (see paging_init()).  See
+     [IA32-v2a] "MOV--Move to/from Control Registers" and
+     [IA32-v3a] 3.7.5 "Base Address of the Page Directory". */
   asm volatile ("movl %0, %%cr3" : : "r" (vtop (pd)) : "memory");
 }
 
@@ -245,19 +246,19 @@ active_pd (void)
 
 /* Seom page table changes can cause the CPU's translation
    lookaside buffer (TLB) to become out-of-sync with the page
-   table.  When this happens, we have to "invalidate" the TLB by
-   re-activating it.
+   table.  When this happens, we have to "invalidate" the TLB
+   entry for the page that changed.
 
-   This function invalidates the TLB if PD is the active page
-   directory.  (If PD is not active then its entries are not in
-   the TLB, so there is no need to invalidate anything.) */
+   This function invalidates the TLB entry for VADDR if PD is the
+   active page directory.  (If PD is not active then its entries
+   are not in the TLB, so there is no need to invalidate
+   anything.)  Unlike re-activating PD, this leaves the rest of
+   the TLB alone, which matters when the clock algorithm clears
+   accessed bits page after page.  See [IA32-v2a] "INVLPG" and
+   [IA32-v3a] 3.12 "Translation Lookaside Buffers (TLBs)". */
 static void
-invalidate_pagedir (uint32_t *pd)
+invalidate_page (uint32_t *pd, const void *vaddr)
 {
   if (active_pd () == pd)
-    {
-      /* Re-activating PD clears the TLB.  See [IA32-v3a] 3.12
-         "Translation Lookaside Buffers (TLBs)". */
-      pagedir_activate (pd);
-    }
+    asm volatile ("invlpg (%0)" : : "r" (vaddr) : "memory");
 }
@@ -21,10 +21,15 @@
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "threads/malloc.h"
+#include "userprog/syscall.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 static int NUM_ARGS = 100;
 static thread_func start_process NO_RETURN;
 static bool load (const char *cmdline, void (**eip) (void), void **esp);
+static void print_thread_stats (void);
 
 /* Starts a new thread running a user program loaded from
    FILENAME.  The new thread may be scheduled (and may even exit)
@@ -40,17 +45,30 @@ process_execute (const char *file_name)
 
   tid_t tid;
 
-  /* Allocate and initialize the shared_block */
+  /* Allocate and initialize the shared_block, with a copy of
+     FILE_NAME at its end for the child to parse.  Otherwise
+     there's a race between the caller and load(). */
+  size_t cmd_size = strlen (file_name) + 1;
   struct shared_block *t_shared_b;
-  t_shared_b = malloc(sizeof (struct shared_block));
+  t_shared_b = malloc(sizeof (struct shared_block) + cmd_size);
+  if (t_shared_b == NULL)
+    return TID_ERROR;
   t_shared_b->exit_status = -1;
   t_shared_b->reference_count = 2;
   sema_init(&t_shared_b->thread_finished, 0);
   sema_init(&t_shared_b->thread_loaded, 0);
   sema_init(&t_shared_b->ref_cnt_sema, 1);
+  memcpy (t_shared_b->cmd_line, file_name, cmd_size);
 
   /* Create a new thread to execute FILE_NAME. */
   tid = thread_create (file_name, PRI_DEFAULT, start_process, t_shared_b);
+  if (tid == TID_ERROR)
+    {
+      free (t_shared_b);
+      return TID_ERROR;
+    }
+  t_shared_b->tid = tid;
+  list_push_back (&thread_current ()->children, &t_shared_b->child_elem);
 
   /* Down until new process is loaded */
   sema_down (&t_shared_b->thread_loaded);
@@ -69,21 +87,22 @@ process_execute (const char *file_name)
 /* A thread function that loads a user process and starts it
    running. */
 static void
-start_process (void *file_name_)
+start_process (void *shared_)
 {
-  char *file_name = file_name_;
+  struct shared_block *shared = shared_;
   struct intr_frame if_;
   bool success;
 
-  /* Split the command and save arguments */
-  char cmd[strlen (file_name)];
-  strlcpy (cmd, file_name, strlen (file_name) + 1);
+  thread_current ()->shared = shared;
+
+  /* Split the command in place and save arguments.  The
+     shared_block, and so the arguments, outlive this thread. */
   char *token, *save_ptr;
 
   char *args[NUM_ARGS];
   int count = 0;
 
-  for (token = strtok_r (cmd, " ", &save_ptr); token != NULL;
+  for (token = strtok_r (shared->cmd_line, " ", &save_ptr); token != NULL;
        token = strtok_r (NULL, " ", &save_ptr))
     {
       args[count++] = token;
@@ -103,7 +122,6 @@ start_process (void *file_name_)
   success = load (args[0], &if_.eip, &if_.esp);
 
   /* If load failed, quit. */
-  palloc_free_page (file_name);
   if (!success)
     {
       thread_current()->shared->load_success = false;
@@ -226,6 +244,25 @@ process_wait (tid_t child_tid UNUSED)
   return exit_status;
 }
 
+/* Prints the running process's statistics, for the "-tstats"
+   kernel option. */
+static void
+print_thread_stats (void)
+{
+  struct thread *cur = thread_current ();
+  struct thread_stats stats;
+
+  thread_get_stats (&stats);
+  printf ("%.*s: stats: run %llu, ready %llu, blocked %llu cycles; "
+          "%llu user + %llu kernel ticks; "
+          "%llu voluntary + %llu involuntary switches; %llu syscalls\n",
+          (int) strcspn (cur->name, " "), cur->name,
+          stats.run_cycles, stats.ready_cycles, stats.blocked_cycles,
+          stats.user_ticks, stats.kernel_ticks,
+          stats.voluntary_switches, stats.involuntary_switches,
+          stats.syscall_total);
+}
+
 /* Free the current process's resources. */
 void
 process_exit (void)
@@ -233,6 +270,20 @@ process_exit (void)
   struct thread *cur = thread_current ();
   uint32_t *pd;
 
+  if (thread_exit_stats && cur->pagedir != NULL)
+    print_thread_stats ();
+
+#ifdef VM
+  /* Write back and remove the process's memory mappings, then
+     free its pages, while its page directory, and the
+     executable they may be read from, are still around.  This
+     has to finish before a waiting parent is woken below, so
+     that it reads the mapped files' new contents. */
+  if (cur->pages != NULL)
+    munmap_all ();
+  page_exit ();
+#endif
+
   /* Update shared blocks of its children */
   struct list_elem new_children[list_size(&cur->children)];
   int nci = 0;
@@ -259,16 +310,19 @@ process_exit (void)
       list_push_back(&cur->children, &new_children[i]);
     }
 
-    /* Update its shared block */
-    sema_down (&cur->shared->ref_cnt_sema);
-    if (-- cur->shared->reference_count == 0)
-      {
-        free (cur->shared);
-      }
-    else
+    /* Update its shared block.  Kernel threads have none. */
+    if (cur->shared != NULL)
       {
-        sema_up (&cur->shared->ref_cnt_sema);
-        sema_up (&cur->shared->thread_finished);
+        sema_down (&cur->shared->ref_cnt_sema);
+        if (-- cur->shared->reference_count == 0)
+          {
+            free (cur->shared);
+          }
+        else
+          {
+            sema_up (&cur->shared->ref_cnt_sema);
+            sema_up (&cur->shared->thread_finished);
+          }
       }
 
     /* Destroy the current process's page directory and switch back
@@ -402,6 +456,13 @@ load (const char *file_name, void (**eip) (void), void **esp)
   t->pagedir = pagedir_create ();
   if (t->pagedir == NULL)
     goto done;
+#ifdef VM
+  list_init (&t->mappings);
+  t->pages = malloc (sizeof *t->pages);
+  if (t->pages == NULL)
+    goto done;
+  hash_init (t->pages, page_hash, page_less, NULL);
+#endif
   process_activate ();
 
   /* Open executable file. */
@@ -510,7 +571,9 @@ load (const char *file_name, void (**eip) (void), void **esp)
 }
 
 /* load() helpers. */
+#ifndef VM
 static bool install_page (void *upage, void *kpage, bool writable);
+#endif
 
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
@@ -569,6 +632,9 @@ validate_segment (const struct Elf32_Phdr *phdr, struct file *file)
    The pages initialized by this function must be writable by the
    user process if WRITABLE is true, read-only otherwise.
 
+   With VM, the pages are only entered into the supplemental page
+   table here, and each is read in when it is first touched.
+
    Return true if successful, false if a memory allocation error
    or disk read error occurs. */
 static bool
@@ -579,7 +645,9 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
   ASSERT (pg_ofs (upage) == 0);
   ASSERT (ofs % PGSIZE == 0);
 
+#ifndef VM
   file_seek (file, ofs);
+#endif
   while (read_bytes > 0 || zero_bytes > 0)
     {
       /* Calculate how to fill this page.
@@ -588,6 +656,19 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
       size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
+#ifdef VM
+      /* Record where to find the page. */
+      struct page *p = page_allocate (upage, !writable);
+      if (p == NULL)
+        return false;
+      if (page_read_bytes > 0)
+        {
+          p->file = file;
+          p->file_offset = ofs;
+          p->file_bytes = page_read_bytes;
+        }
+      ofs += page_read_bytes;
+#else
       /* Get a page of memory. */
       uint8_t *kpage = palloc_get_page (PAL_USER);
       if (kpage == NULL)
@@ -607,6 +688,7 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
           palloc_free_page (kpage);
           return false;
         }
+#endif
 
       /* Advance. */
       read_bytes -= page_read_bytes;
@@ -617,10 +699,17 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 }
 
 /* Create a minimal stack by mapping a zeroed page at the top of
-   user virtual memory. */
+   user virtual memory.  With VM, the page is zeroed when it is
+   first touched, by start_process() pushing the arguments. */
 static bool
 setup_stack (void **esp)
 {
+#ifdef VM
+  if (page_allocate (((uint8_t *) PHYS_BASE) - PGSIZE, false) == NULL)
+    return false;
+  *esp = PHYS_BASE;
+  return true;
+#else
   uint8_t *kpage;
   bool success = false;
 
@@ -634,8 +723,10 @@ setup_stack (void **esp)
         palloc_free_page (kpage);
     }
   return success;
+#endif
 }
 
+#ifndef VM
 /* Adds a mapping from user virtual address UPAGE to kernel
    virtual address KPAGE to the page table.
    If WRITABLE is true, the user process may modify the page;
@@ -655,3 +746,4 @@ install_page (void *upage, void *kpage, bool writable)
   return (pagedir_get_page (t->pagedir, upage) == NULL
           && pagedir_set_page (t->pagedir, upage, kpage, writable));
 }
+#endif
@@ -5,26 +5,52 @@
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
 #include "threads/vaddr.h"
 #include "userprog/pagedir.h"
 #include "userprog/process.h"
 #include "devices/shutdown.h"
 #include "devices/input.h"
 #include "devices/block.h"
+#include "devices/timer.h"
 #include "filesys/filesys.h"
 #include "filesys/file.h"
 #include "filesys/directory.h"
 #include "filesys/inode.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 static void syscall_handler (struct intr_frame *);
+static void count_syscall (uint32_t nr);
+static int get_user (const uint8_t *uaddr);
+static bool put_user (uint8_t *udst, uint8_t byte);
+static bool copy_in (void *dst, const void *usrc, size_t size);
+static bool copy_out (void *udst, const void *src, size_t size);
+static char *copy_in_string (const char *us);
 int user_mem_access_verification(uint32_t* arg, int num_of_args);
-bool is_valid_buffer(uint32_t buf, uint32_t size);
-bool is_valid_filename(const char *file);
+bool is_valid_buffer(uint32_t buf, uint32_t size, bool writable);
 
 /* Global, lowest available file descriptor number. */
 static int available_fd;
 
+#ifdef VM
+/* Global, lowest available memory mapping id. */
+static int available_mapid;
+
+/* A memory-mapped file, in a process's `mappings' list. */
+struct mapping
+  {
+    struct list_elem elem;      /* List element. */
+    mapid_t mapid;              /* Mapping id. */
+    struct file *file;          /* File, reopened for the mapping. */
+    uint8_t *base;              /* Start of memory mapping. */
+    size_t page_cnt;            /* Number of pages mapped. */
+  };
+#endif
+
 /* Print out exit code, for testing purposes. */
 void print_exit_code (int code);
 
@@ -37,52 +63,151 @@ syscall_init (void)
   available_fd = 3;
 }
 
-int
-user_mem_access_verification (uint32_t *args, int index)
+/* Reads a byte at user virtual address UADDR.  Returns the byte
+   value if successful, -1 if UADDR is not a user address or is
+   not mapped.
+
+   The kernel touches user memory directly, so a good pointer
+   costs no more than an ordinary load.  A bad one page faults at
+   get_user_insn, and page_fault() resumes at the address loaded
+   into EAX beforehand, with EAX set to -1.  Must not be inlined
+   or cloned, so that the label is defined exactly once. */
+static int NO_INLINE __attribute__ ((noclone))
+get_user (const uint8_t *uaddr)
+{
+  int result;
+
+  if (!is_user_vaddr (uaddr))
+    return -1;
+  asm volatile ("movl $1f, %0\n\t"
+                ".globl get_user_insn\n"
+                "get_user_insn:\n\t"
+                "movzbl %1, %0\n"
+                "1:"
+                : "=&a" (result) : "m" (*uaddr));
+  return result;
+}
+
+/* Writes BYTE to user address UDST.  Returns true if successful,
+   false if UDST is not a user address or is not mapped.  Faults
+   are handled as in get_user(). */
+static bool NO_INLINE __attribute__ ((noclone))
+put_user (uint8_t *udst, uint8_t byte)
+{
+  int error_code;
+
+  if (!is_user_vaddr (udst))
+    return false;
+  asm volatile ("movl $1f, %0\n\t"
+                ".globl put_user_insn\n"
+                "put_user_insn:\n\t"
+                "movb %b2, %1\n"
+                "1:"
+                : "=&a" (error_code), "=m" (*udst) : "q" (byte));
+  return error_code != -1;
+}
+
+/* Copies SIZE bytes from user address USRC to kernel address
+   DST.  Returns true if successful, false if any byte of USRC
+   is not mapped. */
+static bool
+copy_in (void *dst_, const void *usrc_, size_t size)
 {
-  /* Handle validity of user memory access */
-  if (!is_user_vaddr (&args[index]))
+  uint8_t *dst = dst_;
+  const uint8_t *usrc = usrc_;
+
+  for (; size > 0; size--, dst++, usrc++)
     {
-      return 0;
+      int byte = get_user (usrc);
+      if (byte == -1)
+        return false;
+      *dst = byte;
     }
+  return true;
+}
+
+/* Copies SIZE bytes from kernel address SRC to user address
+   UDST.  Returns true if successful, false if any byte of UDST
+   is not mapped. */
+static bool
+copy_out (void *udst_, const void *src_, size_t size)
+{
+  uint8_t *udst = udst_;
+  const uint8_t *src = src_;
+
+  for (; size > 0; size--, udst++, src++)
+    if (!put_user (udst, *src))
+      return false;
+  return true;
+}
+
+/* Copies the null-terminated string at user address US into a
+   new page, which the caller must free with palloc_free_page().
+   Returns a null pointer if US is not mapped, if it does not fit
+   in a page, or if memory is short. */
+static char *
+copy_in_string (const char *us)
+{
+  char *ks;
+  size_t length;
 
-  /* Ensure that desired address is mapped. */
-  if (pagedir_get_page (thread_current ()->pagedir, &args[index]) == NULL)
+  ks = palloc_get_page (0);
+  if (ks == NULL)
+    return NULL;
+
+  for (length = 0; length < PGSIZE; length++)
     {
-      return 0;
+      int c = get_user ((const uint8_t *) us + length);
+      if (c == -1)
+        break;
+      ks[length] = c;
+      if (c == '\0')
+        return ks;
     }
-
-  return 1;
+  palloc_free_page (ks);
+  return NULL;
 }
 
-/* Ensures that the buffer being used is in
-paged memory and user accessible memory */
-bool
-is_valid_buffer (uint32_t buf, uint32_t size)
+int
+user_mem_access_verification (uint32_t *args, int index)
 {
-  return
-      is_user_vaddr((void *)buf)
-      && pagedir_get_page (thread_current ()->pagedir, (void *)buf) != NULL
-      && is_user_vaddr((void *)buf+size)
-      && pagedir_get_page (thread_current ()->pagedir, (void *)buf+size) != NULL;
+  /* Handle validity of user memory access, and ensure that
+     desired argument is mapped, all 4 bytes of it. */
+  uint32_t arg;
+
+  return copy_in (&arg, &args[index], sizeof arg);
 }
 
-/* Ensures that the filename being used is valid by the
-requirements of user paging and user memory space */
+/* Ensures that the SIZE bytes at BUF are mapped user memory,
+   writable too if WRITABLE is true, by reading one byte in each
+   page.  With VM, page_lock() and read_keyboard() catch
+   read-only pages, so writability is checked here only without
+   VM, by writing back the byte just read.  (With VM that would
+   dirty every page of the buffer.) */
 bool
-is_valid_filename (const char *file)
+is_valid_buffer (uint32_t buf, uint32_t size, bool writable UNUSED)
 {
-  if (!is_user_vaddr (file))
-    {
-      return false;
-    }
-  char *filename = pagedir_get_page (thread_current ()->pagedir, file);
-  if (filename == NULL)
+  uint8_t *p = (uint8_t *) buf;
+  uint8_t *last = p + size - 1;
+
+  if (size == 0)
+    return true;
+  if (last < p)
+    return false;
+
+  for (;;)
     {
-      return false;
+      int byte = get_user (p);
+      if (byte == -1)
+        return false;
+#ifndef VM
+      if (writable && !put_user (p, byte))
+        return false;
+#endif
+      if (pg_no (p) == pg_no (last))
+        return true;
+      p = pg_round_down (p) + PGSIZE;
     }
-  return is_user_vaddr (file + strlen (filename)+1)
-      && pagedir_get_page (thread_current ()->pagedir, file + strlen (filename)+1) != NULL;
 }
 
 /* Executes the command provided by cmd_line if it is valid */
@@ -176,7 +301,6 @@ open (const char *file)
     {
       if ((file_p = file_open (inode)) == NULL)
         return -1;
-      file_data->file_name = file;
       file_data->file_p = file_p;
       file_data->is_directory = false;
     }
@@ -345,6 +469,199 @@ inumber (int fd)
   return inode_get_inumber(file_get_inode (file_data->file_p));
 }
 
+/* Reserves disk space for the `length` bytes of the file open as
+   `fd` starting at `offset`, so that later writes there need not
+   allocate.  The file's size does not change.  Returns false if
+   fd is not an open ordinary file or the space is unavailable. */
+bool
+fallocate (int fd, unsigned offset, unsigned length)
+{
+  struct file_data *file_data;
+  file_data = get_file_data_by_fd (fd);
+
+  /* If no `file_data` match is found OR if it's a directory, fail. */
+  if (file_data == NULL || file_data->is_directory)
+    return false;
+
+  /* Reject empty ranges and ranges that run past the largest off_t. */
+  if (length == 0 || offset + length < offset
+      || offset + length > (unsigned) INT32_MAX)
+    return false;
+
+  return inode_reserve (file_get_inode (file_data->file_p),
+                        offset + length);
+}
+
+#ifdef VM
+/* Removes mapping M from the current process, writing its
+   modified pages back to the file. */
+static void
+unmap (struct mapping *m)
+{
+  size_t i;
+
+  list_remove (&m->elem);
+  for (i = 0; i < m->page_cnt; i++)
+    page_deallocate (m->base + PGSIZE * i);
+  file_close (m->file);
+  free (m);
+}
+
+/* Maps the file open as `fd` into memory at `addr`, which must
+   be page-aligned, one page after another, and returns a mapping
+   id.  The pages are read from the file when first touched, and
+   only modified pages are written back, by munmap() or at exit.
+   The mapping stays valid after `fd` is closed or the file is
+   removed.  Returns MAP_FAILED if `fd` is not an open, nonempty
+   ordinary file or the mapping would overlap any page already in
+   use, including code, data and stack. */
+mapid_t
+mmap (int fd, void *addr)
+{
+  struct file_data *file_data;
+  struct mapping *m;
+  off_t length, offset;
+
+  file_data = get_file_data_by_fd (fd);
+  if (file_data == NULL || file_data->is_directory
+      || addr == NULL || pg_ofs (addr) != 0)
+    return MAP_FAILED;
+
+  m = malloc (sizeof *m);
+  if (m == NULL)
+    return MAP_FAILED;
+  m->file = file_reopen (file_data->file_p);
+  if (m->file == NULL)
+    {
+      free (m);
+      return MAP_FAILED;
+    }
+  m->mapid = available_mapid++;
+  m->base = addr;
+  m->page_cnt = 0;
+  list_push_front (&thread_current ()->mappings, &m->elem);
+
+  offset = 0;
+  length = file_length (m->file);
+  if (length == 0)
+    {
+      unmap (m);
+      return MAP_FAILED;
+    }
+  while (length > 0)
+    {
+      struct page *p = page_allocate (m->base + offset, false);
+      if (p == NULL)
+        {
+          unmap (m);
+          return MAP_FAILED;
+        }
+      p->private = false;
+      p->file = m->file;
+      p->file_offset = offset;
+      p->file_bytes = length >= PGSIZE ? PGSIZE : length;
+      offset += p->file_bytes;
+      length -= p->file_bytes;
+      m->page_cnt++;
+    }
+
+  return m->mapid;
+}
+
+/* Removes memory mapping `mapping`, writing back its modified
+   pages.  Does nothing if there is no such mapping. */
+void
+munmap (mapid_t mapping)
+{
+  struct list *mappings = &thread_current ()->mappings;
+  struct list_elem *e;
+
+  for (e = list_begin (mappings); e != list_end (mappings);
+       e = list_next (e))
+    {
+      struct mapping *m = list_entry (e, struct mapping, elem);
+      if (m->mapid == mapping)
+        {
+          unmap (m);
+          return;
+        }
+    }
+}
+
+/* Removes all of the current process's memory mappings, as it
+   exits. */
+void
+munmap_all (void)
+{
+  struct list *mappings = &thread_current ()->mappings;
+
+  while (!list_empty (mappings))
+    unmap (list_entry (list_front (mappings), struct mapping, elem));
+}
+
+/* Reads (if IS_READ) or writes the SIZE bytes at user address
+   BUFFER from or to the file open as FD, one page at a time.
+   Each page is locked into memory only while the file system
+   copies to or from it, so that the file system never faults on
+   it while holding its own locks, and so that a large buffer
+   never pins more than one frame.  Returns the number of bytes
+   transferred, or -1 if nothing could be.  Kills the process if
+   BUFFER is not mapped. */
+static int
+transfer_paged (int fd, uint8_t *buffer, unsigned size, bool is_read)
+{
+  int total = 0;
+
+  /* Nothing to lock, but FD must still be checked. */
+  if (size == 0)
+    return is_read ? read (fd, buffer, 0) : write (fd, buffer, 0);
+
+  while (size > 0)
+    {
+      unsigned chunk = PGSIZE - pg_ofs (buffer);
+      int result;
+
+      if (chunk > size)
+        chunk = size;
+      if (!page_lock (buffer, is_read))
+        {
+          print_exit_code (-1);
+          thread_exit ();
+        }
+      result = is_read ? read (fd, buffer, chunk) : write (fd, buffer, chunk);
+      page_unlock (buffer);
+
+      if (result < 0)
+        return total > 0 ? total : result;
+      total += result;
+      if ((unsigned) result < chunk)
+        break;
+      buffer += chunk;
+      size -= chunk;
+    }
+  return total;
+}
+
+/* Reads a key from the keyboard into each of the SIZE bytes at
+   user address BUFFER, as read() does for STDIN_FILENO, and
+   returns 1.  is_valid_buffer() has not checked that BUFFER is
+   writable, so the bytes are stored with put_user(), and the
+   process is killed if one of them cannot be. */
+static int
+read_keyboard (uint8_t *buffer, unsigned size)
+{
+  uint8_t key = input_getc ();
+
+  for (; size > 0; size--, buffer++)
+    if (!put_user (buffer, key))
+      {
+        print_exit_code (-1);
+        thread_exit ();
+      }
+  return 1;
+}
+#endif
+
 void
 print_exit_code (int code)
 {
@@ -436,6 +753,38 @@ get_num_writes (void)
   return get_write_cnt ();
 }
 
+/* Copies the file system device's I/O statistics into STATS
+   for proj3 benchmarking. */
+bool
+blkstats (struct block_stats *stats)
+{
+  struct block_stats snapshot;
+
+  block_get_stats (fs_device, &snapshot);
+  return copy_out (stats, &snapshot, sizeof snapshot);
+}
+
+/* Copies the calling thread's statistics into STATS. */
+bool
+threadstat (struct thread_stats *stats)
+{
+  struct thread_stats snapshot;
+
+  thread_get_stats (&snapshot);
+  return copy_out (stats, &snapshot, sizeof snapshot);
+}
+
+/* Counts system call number NR against the calling thread. */
+static void
+count_syscall (uint32_t nr)
+{
+  struct thread_stats *stats = &thread_current ()->stats;
+
+  stats->syscall_total++;
+  if (nr < THREAD_STATS_SYSCALLS)
+    stats->syscall_cnt[nr]++;
+}
+
 static void
 syscall_handler (struct intr_frame *f UNUSED)
 {
@@ -443,15 +792,24 @@ syscall_handler (struct intr_frame *f UNUSED)
   unsigned unsigned_result;
   int int_result;
   int exit_stat;
+  char *kname;
+  char dir_name[NAME_MAX + 1];
+  int64_t ticks_result;
 
   uint32_t *args = ((uint32_t *) f->esp);
+#ifdef VM
+  thread_current ()->user_esp = f->esp;
+#endif
   if (!user_mem_access_verification(args, 0))
     {
       print_exit_code (-1);
       thread_exit ();
     }
 
-  /* Call the appropriate handler for the given syscall. */
+  /* Call the appropriate handler for the given syscall.  Calls
+     that end in thread_exit() never trace their exit. */
+  trace (TRACE_SYSCALL_ENTER, args[0], 0);
+  count_syscall (args[0]);
   switch (args[0])
     {
       case SYS_EXIT:
@@ -467,18 +825,25 @@ syscall_handler (struct intr_frame *f UNUSED)
         break;
 
       case SYS_WAIT:
+        if (!user_mem_access_verification(args, 1))
+          {
+            print_exit_code(-1);
+            thread_exit();
+          }
         exit_stat = wait(args[1]);
         f->eax = exit_stat;
         break;
 
       case SYS_EXEC:
-        if (!is_valid_filename((char *)args[1]))
+        if (!user_mem_access_verification(args, 1)
+            || (kname = copy_in_string ((char *) args[1])) == NULL)
           {
             print_exit_code(-1);
             thread_exit();
           }
         tid_t exec_tid;
-        exec_tid = exec((char *) args[1]);
+        exec_tid = exec(kname);
+        palloc_free_page (kname);
         f->eax = exec_tid;
         break;
 
@@ -487,108 +852,203 @@ syscall_handler (struct intr_frame *f UNUSED)
         break;
 
       case SYS_CREATE:
-        if (!is_valid_filename((char *)args[1]))
+        if (!user_mem_access_verification(args, 2)
+            || (kname = copy_in_string ((char *) args[1])) == NULL)
           {
             f->eax = false;
             print_exit_code(-1);
             thread_exit();
           }
-        bool_result = create((char *) args[1], args[2]);
+        bool_result = create(kname, args[2]);
+        palloc_free_page (kname);
         f->eax = bool_result;
         break;
 
       case SYS_REMOVE:
-        if (!is_valid_filename((char *)args[1]))
+        if (!user_mem_access_verification(args, 1)
+            || (kname = copy_in_string ((char *) args[1])) == NULL)
           {
             f->eax = false;
             print_exit_code(-1);
             thread_exit();
           }
-        bool_result = remove((char *) args[1]);
+        bool_result = remove(kname);
+        palloc_free_page (kname);
         f->eax = bool_result;
         break;
 
       case SYS_OPEN:
-        if (!is_valid_filename((char *) args[1]))
+        if (!user_mem_access_verification(args, 1)
+            || (kname = copy_in_string ((char *) args[1])) == NULL)
           {
             f->eax = -1;
             print_exit_code(-1);
             thread_exit();
           }
-        int_result = open((char *) args[1]);
+        int_result = open(kname);
+        palloc_free_page (kname);
         f->eax = int_result;
         break;
 
       case SYS_FILESIZE:
+        if (!user_mem_access_verification(args, 1))
+          {
+            print_exit_code(-1);
+            thread_exit();
+          }
         int_result = filesize(args[1]);
         f->eax = int_result;
         break;
 
       case SYS_READ:
-        if (!is_valid_buffer(args[2], args[3]))
+        if (!user_mem_access_verification(args, 3)
+            || !is_valid_buffer(args[2], args[3], true))
           {
             f->eax = -1;
             print_exit_code(-1);
             thread_exit();
           }
+#ifdef VM
+        /* The keyboard does not need the buffer locked, but files
+           do. */
+        if (args[1] != STDIN_FILENO)
+          int_result = transfer_paged (args[1], (uint8_t *) args[2],
+                                       args[3], true);
+        else
+          int_result = read_keyboard ((uint8_t *) args[2], args[3]);
+#else
         int_result = read(args[1], (void *) args[2], args[3]);
+#endif
         f->eax = int_result;
         break;
 
       case SYS_WRITE:
-        if (!is_valid_buffer(args[2], args[3]))
+        if (!user_mem_access_verification(args, 3)
+            || !is_valid_buffer(args[2], args[3], false))
           {
             f->eax = -1;
             print_exit_code(-1);
             thread_exit();
           }
+#ifdef VM
+        /* Console writes stay whole, so that they are not
+           interleaved with other output. */
+        if (args[1] != STDOUT_FILENO)
+          int_result = transfer_paged (args[1], (uint8_t *) args[2],
+                                       args[3], false);
+        else
+          int_result = write(args[1], (void *) args[2], args[3]);
+#else
         int_result = write(args[1], (void *) args[2], args[3]);
+#endif
         f->eax = int_result;
         break;
 
       case SYS_SEEK:
+        if (!user_mem_access_verification(args, 2))
+          {
+            print_exit_code(-1);
+            thread_exit();
+          }
         seek(args[1], args[2]);
         break;
 
       case SYS_TELL:
+        if (!user_mem_access_verification(args, 1))
+          {
+            print_exit_code(-1);
+            thread_exit();
+          }
         unsigned_result = tell(args[1]);
         f->eax = unsigned_result;
         break;
 
       case SYS_CLOSE:
+        if (!user_mem_access_verification(args, 1))
+          {
+            print_exit_code(-1);
+            thread_exit();
+          }
         close(args[1]);
         break;
 
       case SYS_PRACTICE:
+        if (!user_mem_access_verification(args, 1))
+          {
+            print_exit_code(-1);
+            thread_exit();
+          }
         f->eax = args[1] + 1;
         break;
 
       case SYS_MKDIR:
-        bool_result = mkdir ((char *) args[1]);
+        if (!user_mem_access_verification(args, 1)
+            || (kname = copy_in_string ((char *) args[1])) == NULL)
+          {
+            print_exit_code(-1);
+            thread_exit();
+          }
+        bool_result = mkdir (kname);
+        palloc_free_page (kname);
         f->eax = bool_result;
         break;
 
       case SYS_CHDIR:
-        bool_result = chdir ((char *) args[1]);
+        if (!user_mem_access_verification(args, 1)
+            || (kname = copy_in_string ((char *) args[1])) == NULL)
+          {
+            print_exit_code(-1);
+            thread_exit();
+          }
+        bool_result = chdir (kname);
+        palloc_free_page (kname);
         f->eax = bool_result;
         break;
 
       case SYS_READDIR:
-        bool_result = readdir ((int) args[1], (char *) args[2]);
+        if (!user_mem_access_verification(args, 2))
+          {
+            print_exit_code(-1);
+            thread_exit();
+          }
+        /* Read the name into the kernel, so that the directory
+           code never touches user memory. */
+        bool_result = readdir ((int) args[1], dir_name);
+        if (bool_result
+            && !copy_out ((char *) args[2], dir_name, strlen (dir_name) + 1))
+          {
+            print_exit_code(-1);
+            thread_exit();
+          }
         f->eax = bool_result;
         break;
 
       case SYS_ISDIR:
+        if (!user_mem_access_verification(args, 1))
+          {
+            print_exit_code(-1);
+            thread_exit();
+          }
         int_result = isdir ((int) args[1]);
         f->eax = int_result;
         break;
 
       case SYS_INUMBER:
+        if (!user_mem_access_verification(args, 1))
+          {
+            print_exit_code(-1);
+            thread_exit();
+          }
         int_result = inumber ((int) args[1]);
         f->eax = int_result;
         break;
 
       case CACHE_STATS:
+        if (!user_mem_access_verification(args, 1))
+          {
+            print_exit_code(-1);
+            thread_exit();
+          }
         unsigned_result = cache_stats(args[1]);
         f->eax = unsigned_result;
         break;
@@ -597,7 +1057,78 @@ syscall_handler (struct intr_frame *f UNUSED)
         f->eax = get_num_writes ();
         break;
 
+      case SYS_BLKSTATS:
+        if (!user_mem_access_verification(args, 1)
+            || !is_valid_buffer(args[1], sizeof (struct block_stats), true))
+          {
+            f->eax = false;
+            print_exit_code(-1);
+            thread_exit();
+          }
+        bool_result = blkstats ((struct block_stats *) args[1]);
+        f->eax = bool_result;
+        break;
+
+      case SYS_TICKS:
+        /* The count is 64 bits, too wide for EAX, so it is
+           returned through the pointer argument. */
+        ticks_result = timer_ticks ();
+        if (!user_mem_access_verification(args, 1)
+            || !copy_out ((void *) args[1], &ticks_result,
+                          sizeof ticks_result))
+          {
+            print_exit_code(-1);
+            thread_exit();
+          }
+        break;
+
+      case SYS_TICKFREQ:
+        f->eax = TIMER_FREQ;
+        break;
+
+      case SYS_FALLOCATE:
+        if (!user_mem_access_verification(args, 3))
+          {
+            print_exit_code(-1);
+            thread_exit();
+          }
+        bool_result = fallocate ((int) args[1], args[2], args[3]);
+        f->eax = bool_result;
+        break;
+
+      case SYS_THREADSTAT:
+        if (!user_mem_access_verification(args, 1)
+            || !is_valid_buffer(args[1], sizeof (struct thread_stats), true))
+          {
+            print_exit_code(-1);
+            thread_exit();
+          }
+        bool_result = threadstat ((struct thread_stats *) args[1]);
+        f->eax = bool_result;
+        break;
+
+#ifdef VM
+      case SYS_MMAP:
+        if (!user_mem_access_verification(args, 2))
+          {
+            print_exit_code(-1);
+            thread_exit();
+          }
+        f->eax = mmap ((int) args[1], (void *) args[2]);
+        break;
+
+      case SYS_MUNMAP:
+        if (!user_mem_access_verification(args, 1))
+          {
+            print_exit_code(-1);
+            thread_exit();
+          }
+        munmap ((mapid_t) args[1]);
+        break;
+#endif
+
       default:
           thread_exit ();
     }
+  trace (TRACE_SYSCALL_EXIT, args[0], 0);
 }
@@ -1,6 +1,8 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 #include <stdbool.h>
+#include <block-stats.h>
+#include <thread-stats.h>
 
 typedef int pid_t;
 #define PID_ERROR ((pid_t) -1)
@@ -35,7 +37,20 @@ bool mkdir (const char *dir);
 bool readdir (int fd, char *name);
 bool isdir (int fd);
 int inumber (int fd);
+bool fallocate (int fd, unsigned offset, unsigned length);
 
 int cache_stats (int stats);
 unsigned long long get_num_writes (void);
+bool blkstats (struct block_stats *stats);
+bool threadstat (struct thread_stats *stats);
+
+#ifdef VM
+typedef int mapid_t;
+#define MAP_FAILED ((mapid_t) -1)
+
+/* Memory-mapped files. */
+mapid_t mmap (int fd, void *addr);
+void munmap (mapid_t mapping);
+void munmap_all (void);
+#endif
 #endif /* userprog/syscall.h */
@@ -0,0 +1,1012 @@
+/* pintos-mkfs: builds, checks, and lists Pintos file system
+   images on the host.
+
+   Formatting a disk with "pintos -f" and then populating it with
+   "pintos -p" copies every file through the guest one byte at a
+   time.  This program instead writes the on-disk structures of
+   filesys/inode.c and filesys/directory.c directly, so that a
+   disk full of test files takes milliseconds to build.  The
+   result is a bare file system partition that can be passed to
+   "pintos --filesys=IMAGE".
+
+   The structures here must be kept in sync with the kernel's
+   struct inode_disk and struct dir_entry.
+
+   Usage: pintos-mkfs [-s SECTORS] IMAGE [FILE...]
+              Creates IMAGE, formats it, and copies each host FILE
+              into its root directory.  Directories are copied
+              recursively.
+          pintos-mkfs -c IMAGE
+              Checks IMAGE for consistency.
+          pintos-mkfs -d IMAGE
+              Lists IMAGE's files and the sectors that hold them,
+              then checks it.
+
+   -c and -d also accept a partitioned disk, such as the
+   filesys.dsk left behind by "pintos --make-disk", and operate on
+   its file system partition. */
+
+#define _GNU_SOURCE 1
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* From devices/block.h. */
+#define SECTOR_SIZE 512
+
+/* From filesys/filesys.h. */
+#define FREE_MAP_SECTOR 0
+#define ROOT_DIR_SECTOR 1
+
+/* From filesys/inode.c and filesys/inode.h. */
+#define INODE_MAGIC 0x494e4f44
+#define DIRECT_CNT 122                  /* Direct pointers. */
+#define INDIRECT_IDX 122                /* Index of indirect pointer. */
+#define DOUBLY_IDX 123                  /* Index of doubly indirect one. */
+#define PTRS_PER_SECTOR 128             /* Pointers in an indirect block. */
+#define MAX_FILE_SECTORS (DIRECT_CNT + PTRS_PER_SECTOR \
+                          + PTRS_PER_SECTOR * PTRS_PER_SECTOR)
+
+/* From filesys/directory.h. */
+#define PINTOS_NAME_MAX 75
+
+/* Initial directory sizes, in entries, used by do_format() for
+   the root directory and by the mkdir system call. */
+#define ROOT_DIR_ENTRIES 16
+#define SUBDIR_ENTRIES 32
+
+/* Partition type of a Pintos file system, from utils/Pintos.pm. */
+#define PART_TYPE_FILESYS 0x21
+
+/* Default image size for creation: 2 MB, as for
+   "pintos --filesys-size=2". */
+#define DEFAULT_SECTORS 4096
+
+/* On-disk inode, as in filesys/inode.h. */
+struct inode_disk
+  {
+    int32_t length;                     /* File size in bytes. */
+    uint32_t next_sector_index;         /* Data blocks allocated, which
+                                           fallocate may put past the
+                                           end of file. */
+    uint32_t pointers[124];             /* 122 direct, 1 indirect,
+                                           1 doubly indirect. */
+    uint32_t is_dir;                    /* 1 if a directory. */
+    uint32_t magic;                     /* INODE_MAGIC. */
+  };
+
+/* On-disk directory entry, as in filesys/directory.c. */
+struct dir_entry
+  {
+    uint32_t inode_sector;              /* Sector number of header. */
+    char name[PINTOS_NAME_MAX + 1];     /* Null terminated file name. */
+    bool in_use;                        /* In use or free? */
+  };
+
+_Static_assert (sizeof (struct inode_disk) == SECTOR_SIZE,
+                "struct inode_disk must be one sector");
+
+/* The image, held in memory in its entirety. */
+static uint8_t *image;
+static uint32_t sector_cnt;
+
+/* Image creation: sectors are handed out in increasing order, so
+   everything below this one is in use. */
+static uint32_t next_free_sector;
+
+/* Image checking. */
+#define NO_OWNER UINT32_MAX
+static uint32_t *owner;                 /* Inode that uses each sector. */
+static unsigned error_cnt;              /* Problems found. */
+static unsigned file_cnt, dir_cnt;      /* Inodes found, by type. */
+static bool dumping;                    /* Print a listing (-d)? */
+
+static void fail (const char *, ...)
+     __attribute__ ((noreturn)) __attribute__ ((format (printf, 1, 2)));
+static void problem (const char *, ...)
+     __attribute__ ((format (printf, 1, 2)));
+
+/* Prints MSG, formatting as with printf(), plus an error message
+   based on errno if it is nonzero, and exits. */
+static void
+fail (const char *msg, ...)
+{
+  va_list args;
+
+  fputs ("pintos-mkfs: ", stderr);
+  va_start (args, msg);
+  vfprintf (stderr, msg, args);
+  va_end (args);
+  if (errno != 0)
+    fprintf (stderr, ": %s", strerror (errno));
+  putc ('\n', stderr);
+  exit (EXIT_FAILURE);
+}
+
+/* Reports an inconsistency found by the checker. */
+static void
+problem (const char *msg, ...)
+{
+  va_list args;
+
+  printf ("error: ");
+  va_start (args, msg);
+  vprintf (msg, args);
+  va_end (args);
+  putchar ('\n');
+  error_cnt++;
+}
+
+static void
+usage (void)
+{
+  fprintf (stderr,
+           "usage: pintos-mkfs [-s SECTORS] IMAGE [FILE...]\n"
+           "       pintos-mkfs -c IMAGE\n"
+           "       pintos-mkfs -d IMAGE\n"
+           "  -s SECTORS  size of the new image (default %d)\n"
+           "  -c          check IMAGE for consistency\n"
+           "  -d          list IMAGE's contents, then check it\n",
+           DEFAULT_SECTORS);
+  exit (EXIT_FAILURE);
+}
+
+static inline uint32_t
+div_round_up (uint32_t x, uint32_t step)
+{
+  return (x + step - 1) / step;
+}
+
+/* Returns the contents of SECTOR, which must be in range. */
+static void *
+sector_data (uint32_t sector)
+{
+  return image + (size_t) sector * SECTOR_SIZE;
+}
+
+/* Image creation. */
+
+/* Allocates and returns the next free sector. */
+static uint32_t
+allocate_sector (void)
+{
+  if (next_free_sector >= sector_cnt)
+    {
+      errno = 0;
+      fail ("image full (%"PRIu32" sectors); use a larger -s", sector_cnt);
+    }
+  return next_free_sector++;
+}
+
+/* Allocates the sector for data block IDX of inode D, along with
+   the indirect blocks that lead to it, in the same order as the
+   kernel's inode_resize_file().  Since sectors are allocated in
+   increasing order, a file's data ends up nearly contiguous, with
+   each indirect block just before the data it points to. */
+static uint32_t
+allocate_block (struct inode_disk *d, uint32_t idx)
+{
+  uint32_t *indirect;
+
+  if (idx < DIRECT_CNT)
+    return d->pointers[idx] = allocate_sector ();
+  idx -= DIRECT_CNT;
+
+  if (idx < PTRS_PER_SECTOR)
+    {
+      if (d->pointers[INDIRECT_IDX] == 0)
+        d->pointers[INDIRECT_IDX] = allocate_sector ();
+      indirect = sector_data (d->pointers[INDIRECT_IDX]);
+      return indirect[idx] = allocate_sector ();
+    }
+  idx -= PTRS_PER_SECTOR;
+
+  if (d->pointers[DOUBLY_IDX] == 0)
+    d->pointers[DOUBLY_IDX] = allocate_sector ();
+  indirect = sector_data (d->pointers[DOUBLY_IDX]);
+  if (indirect[idx / PTRS_PER_SECTOR] == 0)
+    indirect[idx / PTRS_PER_SECTOR] = allocate_sector ();
+  indirect = sector_data (indirect[idx / PTRS_PER_SECTOR]);
+  return indirect[idx % PTRS_PER_SECTOR] = allocate_sector ();
+}
+
+/* Initializes the inode in SECTOR with LENGTH bytes of zeroed
+   data and returns it.  NAME is used in error messages. */
+static struct inode_disk *
+create_inode (uint32_t sector, uint32_t length, bool is_dir,
+              const char *name)
+{
+  struct inode_disk *d = sector_data (sector);
+  uint32_t i;
+
+  if (div_round_up (length, SECTOR_SIZE) > MAX_FILE_SECTORS)
+    {
+      errno = 0;
+      fail ("%s: %"PRIu32" bytes is too large for a Pintos file",
+            name, length);
+    }
+
+  d->length = length;
+  d->next_sector_index = div_round_up (length, SECTOR_SIZE);
+  d->is_dir = is_dir;
+  d->magic = INODE_MAGIC;
+  for (i = 0; i < div_round_up (length, SECTOR_SIZE); i++)
+    allocate_block (d, i);
+  return d;
+}
+
+/* Returns the sector that holds byte offset OFS within D's data,
+   which must be allocated. */
+static uint32_t
+byte_to_sector (const struct inode_disk *d, uint32_t ofs)
+{
+  const uint32_t *indirect;
+  uint32_t idx = ofs / SECTOR_SIZE;
+
+  if (idx < DIRECT_CNT)
+    return d->pointers[idx];
+  idx -= DIRECT_CNT;
+
+  if (idx < PTRS_PER_SECTOR)
+    {
+      indirect = sector_data (d->pointers[INDIRECT_IDX]);
+      return indirect[idx];
+    }
+  idx -= PTRS_PER_SECTOR;
+
+  indirect = sector_data (d->pointers[DOUBLY_IDX]);
+  indirect = sector_data (indirect[idx / PTRS_PER_SECTOR]);
+  return indirect[idx % PTRS_PER_SECTOR];
+}
+
+/* Copies SIZE bytes from BUF into D's data at offset OFS. */
+static void
+inode_write (const struct inode_disk *d, uint32_t ofs,
+             const void *buf_, size_t size)
+{
+  const uint8_t *buf = buf_;
+
+  while (size > 0)
+    {
+      uint32_t sector_ofs = ofs % SECTOR_SIZE;
+      size_t chunk = SECTOR_SIZE - sector_ofs;
+      if (chunk > size)
+        chunk = size;
+
+      memcpy ((uint8_t *) sector_data (byte_to_sector (d, ofs)) + sector_ofs,
+              buf, chunk);
+      buf += chunk;
+      ofs += chunk;
+      size -= chunk;
+    }
+}
+
+/* Copies SIZE bytes at offset OFS in D's data into BUF. */
+static void
+inode_read (const struct inode_disk *d, uint32_t ofs, void *buf_, size_t size)
+{
+  uint8_t *buf = buf_;
+
+  while (size > 0)
+    {
+      uint32_t sector_ofs = ofs % SECTOR_SIZE;
+      size_t chunk = SECTOR_SIZE - sector_ofs;
+      if (chunk > size)
+        chunk = size;
+
+      memcpy (buf, (uint8_t *) sector_data (byte_to_sector (d, ofs))
+              + sector_ofs, chunk);
+      buf += chunk;
+      ofs += chunk;
+      size -= chunk;
+    }
+}
+
+/* Stores an entry for NAME, whose inode is in INODE_SECTOR, as
+   entry number SLOT in directory D. */
+static void
+add_entry (const struct inode_disk *d, size_t slot, const char *name,
+           uint32_t inode_sector)
+{
+  struct dir_entry e;
+
+  memset (&e, 0, sizeof e);
+  e.inode_sector = inode_sector;
+  strncpy (e.name, name, PINTOS_NAME_MAX);
+  e.in_use = true;
+  inode_write (d, slot * sizeof e, &e, sizeof e);
+}
+
+/* Checks that NAME can be stored in a directory entry. */
+static void
+check_name (const char *path, const char *name)
+{
+  errno = 0;
+  if (strlen (name) > PINTOS_NAME_MAX)
+    fail ("%s: name longer than %d characters", path, PINTOS_NAME_MAX);
+}
+
+static uint32_t copy_in (const char *path, uint32_t parent_sector);
+
+/* Returns the last component of PATH, ignoring trailing slashes,
+   in a newly allocated string. */
+static char *
+last_component (const char *path)
+{
+  size_t len = strlen (path);
+  const char *start;
+  char *name;
+
+  while (len > 1 && path[len - 1] == '/')
+    len--;
+  for (start = path + len; start > path && start[-1] != '/'; start--)
+    continue;
+  name = strndup (start, path + len - start);
+  if (name == NULL)
+    fail ("out of memory");
+  return name;
+}
+
+/* Copies the host directory at PATH into a new directory whose
+   inode goes in SECTOR, adding "." and ".." entries (with ".."
+   pointing to PARENT_SECTOR) unless it is the root.  Pass the
+   root's names in ROOT_FILES, or a null pointer otherwise. */
+static void
+copy_in_dir (const char *path, uint32_t sector, uint32_t parent_sector,
+             char **root_files, int root_file_cnt)
+{
+  bool is_root = sector == ROOT_DIR_SECTOR;
+  struct dirent **names = NULL;
+  size_t min_entries = is_root ? ROOT_DIR_ENTRIES : SUBDIR_ENTRIES;
+  size_t name_cnt, entry_cnt, slot, i;
+  struct inode_disk *d;
+
+  if (is_root)
+    name_cnt = root_file_cnt;
+  else
+    {
+      int n = scandir (path, &names, NULL, alphasort);
+      if (n < 0)
+        fail ("%s", path);
+      name_cnt = n;
+    }
+
+  entry_cnt = name_cnt + (is_root ? 0 : 2);
+  if (entry_cnt < min_entries)
+    entry_cnt = min_entries;
+  d = create_inode (sector, entry_cnt * sizeof (struct dir_entry), true,
+                    path);
+
+  slot = 0;
+  if (!is_root)
+    {
+      add_entry (d, slot++, ".", sector);
+      add_entry (d, slot++, "..", parent_sector);
+    }
+  for (i = 0; i < name_cnt; i++)
+    {
+      if (is_root)
+        {
+          char *name = last_component (root_files[i]);
+          size_t j;
+
+          check_name (root_files[i], name);
+          for (j = 0; j < i; j++)
+            {
+              char *other = last_component (root_files[j]);
+              if (!strcmp (name, other))
+                fail ("%s: more than one file named \"%s\"",
+                      root_files[i], name);
+              free (other);
+            }
+          add_entry (d, slot++, name, copy_in (root_files[i], sector));
+          free (name);
+        }
+      else
+        {
+          const char *name = names[i]->d_name;
+          char *child;
+
+          if (strcmp (name, ".") && strcmp (name, ".."))
+            {
+              if (asprintf (&child, "%s/%s", path, name) < 0)
+                fail ("out of memory");
+              check_name (child, name);
+              add_entry (d, slot++, name, copy_in (child, sector));
+              free (child);
+            }
+          free (names[i]);
+        }
+    }
+  free (names);
+}
+
+/* Copies the host file or directory at PATH into the image, in a
+   directory whose inode is in PARENT_SECTOR, and returns the
+   sector of its inode. */
+static uint32_t
+copy_in (const char *path, uint32_t parent_sector)
+{
+  struct stat st;
+  uint32_t sector;
+
+  if (stat (path, &st) < 0)
+    fail ("%s", path);
+
+  sector = allocate_sector ();
+  if (S_ISDIR (st.st_mode))
+    copy_in_dir (path, sector, parent_sector, NULL, 0);
+  else if (S_ISREG (st.st_mode))
+    {
+      struct inode_disk *d;
+      uint32_t ofs;
+      int fd;
+
+      errno = 0;
+      if (st.st_size > MAX_FILE_SECTORS * SECTOR_SIZE)
+        fail ("%s: too large for a Pintos file", path);
+      d = create_inode (sector, st.st_size, false, path);
+
+      fd = open (path, O_RDONLY);
+      if (fd < 0)
+        fail ("%s", path);
+      for (ofs = 0; ofs < (uint32_t) st.st_size; ofs += SECTOR_SIZE)
+        {
+          ssize_t n = read (fd, sector_data (byte_to_sector (d, ofs)),
+                            SECTOR_SIZE);
+          if (n <= 0)
+            {
+              if (n == 0)
+                errno = 0;
+              fail ("%s: read failed", path);
+            }
+        }
+      close (fd);
+    }
+  else
+    {
+      errno = 0;
+      fail ("%s: not a regular file or directory", path);
+    }
+  return sector;
+}
+
+/* Formats the in-memory image and copies the FILE_CNT host files
+   in FILES into its root directory. */
+static void
+make_fs (char **files, int file_cnt)
+{
+  /* The free map is a file of 32-bit words, one bit per sector,
+     as written by lib/kernel/bitmap.c. */
+  uint32_t map_bytes = div_round_up (sector_cnt, 32) * 4;
+  struct inode_disk *map;
+  uint8_t *bits;
+  uint32_t i;
+
+  next_free_sector = ROOT_DIR_SECTOR + 1;
+  map = create_inode (FREE_MAP_SECTOR, map_bytes, false, "free map");
+  copy_in_dir ("/", ROOT_DIR_SECTOR, ROOT_DIR_SECTOR, files, file_cnt);
+
+  bits = calloc (1, map_bytes);
+  if (bits == NULL)
+    fail ("out of memory");
+  for (i = 0; i < next_free_sector; i++)
+    bits[i / 8] |= 1 << (i % 8);
+  inode_write (map, 0, bits, map_bytes);
+  free (bits);
+}
+
+/* Image checking. */
+
+/* Marks SECTOR as used by the inode in INODE_SECTOR for WHAT.
+   Returns false if SECTOR is out of range or already in use. */
+static bool
+claim (uint32_t sector, uint32_t inode_sector, const char *path,
+       const char *what)
+{
+  if (sector >= sector_cnt)
+    {
+      problem ("%s: %s sector %"PRIu32" is past end of image "
+               "(%"PRIu32" sectors)", path, what, sector, sector_cnt);
+      return false;
+    }
+  if (owner[sector] != NO_OWNER)
+    {
+      problem ("%s: %s sector %"PRIu32" is also used by inode %"PRIu32,
+               path, what, sector, owner[sector]);
+      return false;
+    }
+  owner[sector] = inode_sector;
+  return true;
+}
+
+/* Checks the LIMIT pointers in PTRS, of which the first USED
+   should point to data blocks and the rest should be zero.
+   Claims the data blocks for the inode in INODE_SECTOR. */
+static bool
+check_pointers (const uint32_t *ptrs, uint32_t limit, uint32_t used,
+                uint32_t inode_sector, const char *path)
+{
+  bool ok = true;
+  uint32_t i;
+
+  for (i = 0; i < limit; i++)
+    if (i < used)
+      {
+        if (ptrs[i] == 0)
+          {
+            problem ("%s: data block is not allocated", path);
+            ok = false;
+          }
+        else if (!claim (ptrs[i], inode_sector, path, "data"))
+          ok = false;
+      }
+    else if (ptrs[i] != 0)
+      {
+        problem ("%s: stale pointer to sector %"PRIu32" past end of file",
+                 path, ptrs[i]);
+        ok = false;
+      }
+  return ok;
+}
+
+/* Checks that indirect block pointer PTR is present exactly when
+   NEEDED, and claims it.  Returns true if the block it points to
+   may be examined. */
+static bool
+check_indirect (uint32_t ptr, bool needed, uint32_t inode_sector,
+                const char *path)
+{
+  if (!needed)
+    {
+      if (ptr != 0)
+        problem ("%s: stale pointer to indirect block %"PRIu32,
+                 path, ptr);
+      return false;
+    }
+  if (ptr == 0)
+    {
+      problem ("%s: indirect block is not allocated", path);
+      return false;
+    }
+  return claim (ptr, inode_sector, path, "indirect");
+}
+
+/* Returns the number of data blocks allocated to D: those
+   covering its length, plus any reserved past the end of file by
+   fallocate. */
+static uint32_t
+allocated_blocks (const struct inode_disk *d)
+{
+  uint32_t blocks = div_round_up (d->length, SECTOR_SIZE);
+  return d->next_sector_index > blocks ? d->next_sector_index : blocks;
+}
+
+/* Checks the block pointers of inode D, in INODE_SECTOR, and
+   claims its blocks.  Returns true if its data can be read. */
+static bool
+check_blocks (const struct inode_disk *d, uint32_t inode_sector,
+              const char *path)
+{
+  uint32_t blocks = allocated_blocks (d);
+  uint32_t used;
+  bool ok;
+
+  used = blocks < DIRECT_CNT ? blocks : DIRECT_CNT;
+  ok = check_pointers (d->pointers, DIRECT_CNT, used, inode_sector, path);
+  blocks -= used;
+
+  if (check_indirect (d->pointers[INDIRECT_IDX], blocks > 0,
+                      inode_sector, path))
+    {
+      used = blocks < PTRS_PER_SECTOR ? blocks : PTRS_PER_SECTOR;
+      ok &= check_pointers (sector_data (d->pointers[INDIRECT_IDX]),
+                            PTRS_PER_SECTOR, used, inode_sector, path);
+    }
+  else if (blocks > 0)
+    ok = false;
+  blocks -= blocks < PTRS_PER_SECTOR ? blocks : PTRS_PER_SECTOR;
+
+  if (check_indirect (d->pointers[DOUBLY_IDX], blocks > 0,
+                      inode_sector, path))
+    {
+      const uint32_t *doubly = sector_data (d->pointers[DOUBLY_IDX]);
+      uint32_t i;
+
+      for (i = 0; i < PTRS_PER_SECTOR; i++)
+        {
+          used = blocks < PTRS_PER_SECTOR ? blocks : PTRS_PER_SECTOR;
+          if (check_indirect (doubly[i], used > 0, inode_sector, path))
+            ok &= check_pointers (sector_data (doubly[i]), PTRS_PER_SECTOR,
+                                  used, inode_sector, path);
+          else if (used > 0)
+            ok = false;
+          blocks -= used;
+        }
+    }
+  else if (blocks > 0)
+    ok = false;
+
+  return ok;
+}
+
+/* Prints the sectors holding D's data as a list of ranges. */
+static void
+print_extents (const struct inode_disk *d)
+{
+  uint32_t start = 0, end = 0;
+  uint32_t ofs;
+
+  for (ofs = 0; ofs < (uint32_t) d->length; ofs += SECTOR_SIZE)
+    {
+      uint32_t sector = byte_to_sector (d, ofs);
+      if (ofs > 0 && sector == end + 1)
+        end = sector;
+      else
+        {
+          if (ofs > 0)
+            printf (start == end ? " %"PRIu32 : " %"PRIu32"-%"PRIu32,
+                    start, end);
+          start = end = sector;
+        }
+    }
+  if (d->length > 0)
+    printf (start == end ? " %"PRIu32 : " %"PRIu32"-%"PRIu32, start, end);
+}
+
+/* Checks the inode in SECTOR, which the directory entry at PATH
+   refers to, and claims its sectors.  Returns the inode if it is
+   intact enough to read its data, otherwise a null pointer. */
+static const struct inode_disk *
+check_inode (uint32_t sector, const char *path)
+{
+  const struct inode_disk *d;
+
+  if (!claim (sector, sector, path, "inode"))
+    return NULL;
+  d = sector_data (sector);
+  if (d->magic != INODE_MAGIC)
+    {
+      problem ("%s: inode %"PRIu32" has bad magic %#"PRIx32,
+               path, sector, d->magic);
+      return NULL;
+    }
+  if (d->length < 0
+      || div_round_up (d->length, SECTOR_SIZE) > MAX_FILE_SECTORS)
+    {
+      problem ("%s: inode %"PRIu32" has bad length %"PRId32,
+               path, sector, d->length);
+      return NULL;
+    }
+  if (d->next_sector_index > MAX_FILE_SECTORS)
+    {
+      problem ("%s: inode %"PRIu32" has bad block count %"PRIu32,
+               path, sector, d->next_sector_index);
+      return NULL;
+    }
+  if (d->is_dir > 1)
+    problem ("%s: inode %"PRIu32" has bad directory flag %"PRIu32,
+             path, sector, d->is_dir);
+  if (!check_blocks (d, sector, path))
+    return NULL;
+
+  if (dumping)
+    {
+      printf ("%s: %s, inode %"PRIu32", %"PRId32" bytes, sectors",
+              path, d->is_dir ? "directory" : "file", sector, d->length);
+      print_extents (d);
+      if (allocated_blocks (d) > div_round_up (d->length, SECTOR_SIZE))
+        printf (", %"PRIu32" blocks reserved",
+                allocated_blocks (d) - div_round_up (d->length, SECTOR_SIZE));
+      putchar ('\n');
+    }
+  return d;
+}
+
+static void check_dir (const struct inode_disk *, uint32_t sector,
+                       uint32_t parent_sector, const char *path);
+
+/* Checks directory entry E, found at PATH in the directory whose
+   inode is in DIR_SECTOR. */
+static void
+check_entry (const struct dir_entry *e, uint32_t dir_sector,
+             uint32_t parent_sector, const char *path)
+{
+  const struct inode_disk *d;
+
+  if (!strcmp (e->name, "."))
+    {
+      if (e->inode_sector != dir_sector)
+        problem ("%s: \".\" refers to inode %"PRIu32", not %"PRIu32,
+                 path, e->inode_sector, dir_sector);
+      return;
+    }
+  if (!strcmp (e->name, ".."))
+    {
+      if (e->inode_sector != parent_sector)
+        problem ("%s: \"..\" refers to inode %"PRIu32", not %"PRIu32,
+                 path, e->inode_sector, parent_sector);
+      return;
+    }
+
+  if (e->inode_sector < sector_cnt && owner[e->inode_sector] != NO_OWNER)
+    {
+      problem ("%s: inode %"PRIu32" is already in use (hard link or "
+               "directory loop)", path, e->inode_sector);
+      return;
+    }
+  d = check_inode (e->inode_sector, path);
+  if (d == NULL)
+    return;
+  if (d->is_dir)
+    {
+      dir_cnt++;
+      check_dir (d, e->inode_sector, dir_sector, path);
+    }
+  else
+    file_cnt++;
+}
+
+/* Checks directory D, whose inode is in SECTOR and whose parent
+   directory's inode is in PARENT_SECTOR, and everything in it. */
+static void
+check_dir (const struct inode_disk *d, uint32_t sector,
+           uint32_t parent_sector, const char *path)
+{
+  struct dir_entry e;
+  uint32_t ofs;
+
+  if (d->length % sizeof e != 0)
+    problem ("%s: directory length %"PRId32" is not a multiple of %zu",
+             path, d->length, sizeof e);
+
+  for (ofs = 0; ofs + sizeof e <= (uint32_t) d->length; ofs += sizeof e)
+    {
+      struct dir_entry other;
+      uint32_t other_ofs;
+      char *child;
+
+      inode_read (d, ofs, &e, sizeof e);
+      if (!e.in_use)
+        continue;
+
+      if (memchr (e.name, '\0', sizeof e.name) == NULL)
+        {
+          problem ("%s: entry at offset %"PRIu32" has an unterminated name",
+                   path, ofs);
+          continue;
+        }
+      if (e.name[0] == '\0' || strchr (e.name, '/') != NULL)
+        {
+          problem ("%s: entry at offset %"PRIu32" has bad name \"%s\"",
+                   path, ofs, e.name);
+          continue;
+        }
+      for (other_ofs = 0; other_ofs < ofs; other_ofs += sizeof other)
+        {
+          inode_read (d, other_ofs, &other, sizeof other);
+          if (other.in_use && !strncmp (other.name, e.name, sizeof e.name))
+            {
+              problem ("%s: duplicate entry \"%s\"", path, e.name);
+              break;
+            }
+        }
+      if (other_ofs < ofs)
+        continue;
+
+      if (asprintf (&child, "%s%s%s", path, path[1] != '\0' ? "/" : "",
+                    e.name) < 0)
+        fail ("out of memory");
+      check_entry (&e, sector, parent_sector, child);
+      free (child);
+    }
+}
+
+/* Checks the free map, in the inode in FREE_MAP_SECTOR, against
+   the sectors that were found to be in use. */
+static void
+check_free_map (const struct inode_disk *map)
+{
+  uint32_t map_bytes = div_round_up (sector_cnt, 32) * 4;
+  uint32_t leaked = 0, leaked_first = 0;
+  uint8_t *bits;
+  uint32_t i;
+
+  if ((uint32_t) map->length < map_bytes)
+    {
+      problem ("free map is %"PRId32" bytes, but %"PRIu32" sectors need "
+               "%"PRIu32, map->length, sector_cnt, map_bytes);
+      return;
+    }
+
+  bits = malloc (map_bytes);
+  if (bits == NULL)
+    fail ("out of memory");
+  inode_read (map, 0, bits, map_bytes);
+  for (i = 0; i < sector_cnt; i++)
+    {
+      bool marked = (bits[i / 8] >> (i % 8)) & 1;
+      if (owner[i] != NO_OWNER && !marked)
+        problem ("sector %"PRIu32", used by inode %"PRIu32", is marked "
+                 "free", i, owner[i]);
+      else if (owner[i] == NO_OWNER && marked)
+        {
+          if (leaked++ == 0)
+            leaked_first = i;
+        }
+    }
+  if (leaked > 0)
+    problem ("%"PRIu32" sectors are marked in use but not used by any "
+             "file (first is %"PRIu32")", leaked, leaked_first);
+  free (bits);
+}
+
+/* Checks the whole file system, printing a listing first if
+   DUMPING.  Returns true if no problems were found. */
+static bool
+check_fs (void)
+{
+  const struct inode_disk *map, *root;
+  uint32_t used = 0;
+  uint32_t i;
+
+  owner = malloc (sector_cnt * sizeof *owner);
+  if (owner == NULL)
+    fail ("out of memory");
+  for (i = 0; i < sector_cnt; i++)
+    owner[i] = NO_OWNER;
+  error_cnt = file_cnt = dir_cnt = 0;
+
+  if (sector_cnt <= ROOT_DIR_SECTOR)
+    problem ("image is too small to hold a file system");
+  else
+    {
+      map = check_inode (FREE_MAP_SECTOR, "(free map)");
+      root = check_inode (ROOT_DIR_SECTOR, "/");
+      if (root != NULL)
+        {
+          if (!root->is_dir)
+            problem ("/: root inode is not a directory");
+          else
+            check_dir (root, ROOT_DIR_SECTOR, ROOT_DIR_SECTOR, "/");
+        }
+      if (map != NULL)
+        check_free_map (map);
+    }
+
+  for (i = 0; i < sector_cnt; i++)
+    if (owner[i] != NO_OWNER)
+      used++;
+  printf ("%u files, %u directories, %"PRIu32"/%"PRIu32" sectors used, "
+          "%u errors\n", file_cnt, dir_cnt, used, sector_cnt, error_cnt);
+  free (owner);
+  return error_cnt == 0;
+}
+
+/* Reads IMAGE_NAME into memory.  If it is a partitioned disk,
+   only its file system partition is used. */
+static void
+read_image (const char *image_name)
+{
+  uint8_t mbr[SECTOR_SIZE];
+  uint64_t start = 0, size;
+  struct stat st;
+  int fd;
+
+  fd = open (image_name, O_RDONLY);
+  if (fd < 0 || fstat (fd, &st) < 0)
+    fail ("%s", image_name);
+  size = st.st_size / SECTOR_SIZE;
+
+  /* A partitioned disk has a boot signature at the end of its
+     first sector, where a bare file system has its free map
+     inode's magic number instead. */
+  if (pread (fd, mbr, sizeof mbr, 0) == sizeof mbr
+      && mbr[510] == 0x55 && mbr[511] == 0xaa)
+    {
+      int i;
+
+      for (i = 0; i < 4; i++)
+        {
+          const uint8_t *p = mbr + 446 + 16 * i;
+          if (p[4] == PART_TYPE_FILESYS)
+            {
+              memcpy (&start, p + 8, 4);
+              size = 0;
+              memcpy (&size, p + 12, 4);
+              break;
+            }
+        }
+      errno = 0;
+      if (i >= 4)
+        fail ("%s: partitioned disk has no file system partition",
+              image_name);
+    }
+
+  errno = 0;
+  if (size == 0 || size > UINT32_MAX)
+    fail ("%s: bad image size", image_name);
+  sector_cnt = size;
+  image = malloc ((size_t) sector_cnt * SECTOR_SIZE);
+  if (image == NULL)
+    fail ("out of memory");
+  if (pread (fd, image, (size_t) sector_cnt * SECTOR_SIZE,
+             start * SECTOR_SIZE) != (ssize_t) sector_cnt * SECTOR_SIZE)
+    fail ("%s: short read", image_name);
+  close (fd);
+}
+
+/* Writes the in-memory image to IMAGE_NAME. */
+static void
+write_image (const char *image_name)
+{
+  size_t size = (size_t) sector_cnt * SECTOR_SIZE;
+  int fd;
+
+  fd = open (image_name, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0)
+    fail ("%s", image_name);
+  if (write (fd, image, size) != (ssize_t) size || close (fd) < 0)
+    fail ("%s: write failed", image_name);
+}
+
+int
+main (int argc, char *argv[])
+{
+  enum { CREATE, CHECK, DUMP } mode = CREATE;
+  unsigned long sectors = DEFAULT_SECTORS;
+  int opt;
+
+  while ((opt = getopt (argc, argv, "s:cd")) != -1)
+    switch (opt)
+      {
+      case 's':
+        sectors = strtoul (optarg, NULL, 0);
+        if (sectors <= ROOT_DIR_SECTOR || sectors > UINT32_MAX)
+          usage ();
+        break;
+      case 'c':
+        mode = CHECK;
+        break;
+      case 'd':
+        mode = DUMP;
+        break;
+      default:
+        usage ();
+      }
+  if (optind >= argc || (mode != CREATE && optind + 1 != argc))
+    usage ();
+
+  if (mode == CREATE)
+    {
+      sector_cnt = sectors;
+      image = calloc (sector_cnt, SECTOR_SIZE);
+      if (image == NULL)
+        fail ("out of memory");
+      make_fs (argv + optind + 1, argc - optind - 1);
+
+      /* Catch bugs here rather than in the kernel. */
+      if (!check_fs ())
+        {
+          errno = 0;
+          fail ("internal error: new image is inconsistent");
+        }
+      write_image (argv[optind]);
+    }
+  else
+    {
+      read_image (argv[optind]);
+      dumping = mode == DUMP;
+      if (!check_fs ())
+        return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,318 @@
+#include "vm/frame.h"
+#include <debug.h>
+#include <stdio.h>
+#include "vm/page.h"
+#include "devices/timer.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* The frame table: one entry per page in the user pool. */
+static struct frame *frames;
+static size_t frame_cnt;
+
+/* Serializes searches of the frame table for a free frame or a
+   victim. */
+static struct lock scan_lock;
+
+/* Clock hand: the next frame considered for eviction. */
+static size_t hand;
+
+/* Shared frames, keyed by inode and offset, and a lock that
+   protects the table.  share_lock may be acquired while holding
+   a frame's lock, but not the other way around. */
+static struct hash shared_frames;
+static struct lock share_lock;
+
+static hash_hash_func shared_frame_hash;
+static hash_less_func shared_frame_less;
+
+/* Initializes the frame table, taking over all of the user
+   pool. */
+void
+frame_init (void)
+{
+  void *base;
+
+  lock_init (&scan_lock);
+  lock_init (&share_lock);
+  hash_init (&shared_frames, shared_frame_hash, shared_frame_less, NULL);
+
+  frames = malloc (sizeof *frames * init_ram_pages);
+  if (frames == NULL)
+    PANIC ("out of memory allocating page frames");
+
+  while ((base = palloc_get_page (PAL_USER)) != NULL)
+    {
+      struct frame *f = &frames[frame_cnt++];
+      lock_init (&f->lock);
+      f->base = base;
+      list_init (&f->pages);
+      f->inode = NULL;
+    }
+}
+
+/* Removes locked frame F from the shared frame table, if it is
+   in it. */
+static void
+unshare (struct frame *f)
+{
+  if (f->inode != NULL)
+    {
+      lock_acquire (&share_lock);
+      hash_delete (&shared_frames, &f->hash_elem);
+      lock_release (&share_lock);
+      f->inode = NULL;
+    }
+}
+
+/* Returns true if any page in locked frame F has been accessed
+   recently, clearing the accessed bits of all of them. */
+static bool
+frame_accessed_recently (struct frame *f)
+{
+  bool was_accessed = false;
+  struct list_elem *e;
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    if (page_accessed_recently (list_entry (e, struct page, frame_elem)))
+      was_accessed = true;
+  return was_accessed;
+}
+
+/* Evicts every page in locked frame F.  Returns true if
+   successful, false if some page could not be saved, in which
+   case that page and any after it stay in F. */
+static bool
+evict (struct frame *f)
+{
+  while (!list_empty (&f->pages))
+    {
+      struct page *p = list_entry (list_front (&f->pages),
+                                   struct page, frame_elem);
+      if (!page_out (p))
+        return false;
+      list_pop_front (&f->pages);
+      p->frame = NULL;
+    }
+  unshare (f);
+  return true;
+}
+
+/* Tries to allocate and lock a frame for PAGE.
+   Returns the frame if successful, a null pointer on failure. */
+static struct frame *
+try_frame_alloc_and_lock (struct page *page)
+{
+  size_t i;
+
+  lock_acquire (&scan_lock);
+
+  /* Find a free frame.  Skip frames that we have locked
+     ourselves, e.g. one holding a page locked by page_lock(). */
+  for (i = 0; i < frame_cnt; i++)
+    {
+      struct frame *f = &frames[i];
+      if (lock_held_by_current_thread (&f->lock)
+          || !lock_try_acquire (&f->lock))
+        continue;
+      if (list_empty (&f->pages))
+        {
+          list_push_back (&f->pages, &page->frame_elem);
+          lock_release (&scan_lock);
+          return f;
+        }
+      lock_release (&f->lock);
+    }
+
+  /* No free frame.  Find a frame to evict with the clock
+     algorithm: sweep the hand over the frames, giving each
+     recently accessed frame a second chance by clearing its
+     accessed bits, and take the first frame that has not been
+     accessed since the last sweep.  Two full sweeps suffice
+     unless every frame is locked. */
+  for (i = 0; i < frame_cnt * 2; i++)
+    {
+      /* Get a frame. */
+      struct frame *f = &frames[hand];
+      if (++hand >= frame_cnt)
+        hand = 0;
+
+      if (lock_held_by_current_thread (&f->lock)
+          || !lock_try_acquire (&f->lock))
+        continue;
+
+      if (list_empty (&f->pages))
+        {
+          list_push_back (&f->pages, &page->frame_elem);
+          lock_release (&scan_lock);
+          return f;
+        }
+
+      if (frame_accessed_recently (f))
+        {
+          lock_release (&f->lock);
+          continue;
+        }
+
+      lock_release (&scan_lock);
+
+      /* Evict this frame. */
+      if (!evict (f))
+        {
+          lock_release (&f->lock);
+          return NULL;
+        }
+
+      list_push_back (&f->pages, &page->frame_elem);
+      return f;
+    }
+
+  lock_release (&scan_lock);
+  return NULL;
+}
+
+/* Tries really hard to allocate and lock a frame for PAGE,
+   evicting another page if necessary.  Returns the frame if
+   successful, or a null pointer if every frame stays locked or
+   swap is full. */
+struct frame *
+frame_alloc_and_lock (struct page *page)
+{
+  size_t try;
+
+  for (try = 0; try < 3; try++)
+    {
+      struct frame *f = try_frame_alloc_and_lock (page);
+      if (f != NULL)
+        {
+          ASSERT (lock_held_by_current_thread (&f->lock));
+          return f;
+        }
+      timer_msleep (1000);
+    }
+
+  return NULL;
+}
+
+/* Looks for a shared frame holding the page at OFFSET in INODE.
+   If there is one, locks it, adds PAGE to it, and returns it.
+   Otherwise, returns a null pointer. */
+struct frame *
+frame_lock_shared (struct page *page, struct inode *inode, off_t offset)
+{
+  for (;;)
+    {
+      struct frame key;
+      struct frame *f;
+      struct hash_elem *e;
+
+      key.inode = inode;
+      key.offset = offset;
+      lock_acquire (&share_lock);
+      e = hash_find (&shared_frames, &key.hash_elem);
+      lock_release (&share_lock);
+      if (e == NULL)
+        return NULL;
+
+      /* The frame could be evicted, and even reused, while we
+         wait for its lock, so check that it still holds the
+         page afterward. */
+      f = hash_entry (e, struct frame, hash_elem);
+      lock_acquire (&f->lock);
+      if (f->inode == inode && f->offset == offset)
+        {
+          list_push_back (&f->pages, &page->frame_elem);
+          return f;
+        }
+      lock_release (&f->lock);
+    }
+}
+
+/* Enters locked frame F, which holds the page at OFFSET in
+   INODE, into the shared frame table, so that other processes
+   can find it with frame_lock_shared().  If another frame with
+   the same page got there first, F stays private. */
+void
+frame_share (struct frame *f, struct inode *inode, off_t offset)
+{
+  ASSERT (lock_held_by_current_thread (&f->lock));
+  ASSERT (f->inode == NULL);
+
+  f->inode = inode;
+  f->offset = offset;
+  lock_acquire (&share_lock);
+  if (hash_insert (&shared_frames, &f->hash_elem) != NULL)
+    f->inode = NULL;
+  lock_release (&share_lock);
+}
+
+/* Locks PAGE's frame into memory, if it has one.
+   Upon return, PAGE->frame will not change until PAGE is
+   unlocked. */
+void
+frame_lock (struct page *p)
+{
+  /* A frame can be asynchronously removed, but never inserted. */
+  struct frame *f = p->frame;
+  if (f != NULL)
+    {
+      lock_acquire (&f->lock);
+      if (f != p->frame)
+        {
+          lock_release (&f->lock);
+          ASSERT (p->frame == NULL);
+        }
+    }
+}
+
+/* Removes page P from its frame, which must be locked by the
+   current thread, and unlocks the frame.  Once no page is left
+   in the frame it may be used by another page, and any data in
+   it is lost. */
+void
+frame_free (struct page *p)
+{
+  struct frame *f = p->frame;
+
+  ASSERT (lock_held_by_current_thread (&f->lock));
+
+  list_remove (&p->frame_elem);
+  p->frame = NULL;
+  if (list_empty (&f->pages))
+    unshare (f);
+  lock_release (&f->lock);
+}
+
+/* Unlocks frame F, allowing it to be evicted.
+   F must be locked for use by the current process. */
+void
+frame_unlock (struct frame *f)
+{
+  ASSERT (lock_held_by_current_thread (&f->lock));
+  lock_release (&f->lock);
+}
+
+/* Returns a hash value for shared frame E. */
+static unsigned
+shared_frame_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct frame *f = hash_entry (e, struct frame, hash_elem);
+  return hash_bytes (&f->inode, sizeof f->inode) ^ hash_int (f->offset);
+}
+
+/* Returns true if shared frame A precedes shared frame B. */
+static bool
+shared_frame_less (const struct hash_elem *a_, const struct hash_elem *b_,
+                   void *aux UNUSED)
+{
+  const struct frame *a = hash_entry (a_, struct frame, hash_elem);
+  const struct frame *b = hash_entry (b_, struct frame, hash_elem);
+
+  if (a->inode != b->inode)
+    return a->inode < b->inode;
+  return a->offset < b->offset;
+}
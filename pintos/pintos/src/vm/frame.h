@@ -0,0 +1,49 @@
+#ifndef VM_FRAME_H
+#define VM_FRAME_H
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include "filesys/off_t.h"
+#include "threads/synch.h"
+
+struct inode;
+struct page;
+
+/* A physical frame in the user pool.
+
+   At boot, frame_init() takes every page in palloc's user pool
+   into the frame table, so user pages are allocated only through
+   frame_alloc_and_lock(), which evicts pages when no frame is
+   free.  A frame's lock "pins" it: while it is held, the frame's
+   pages cannot be changed or evicted.
+
+   A frame usually holds one process's page.  A read-only page of
+   an executable, though, is the same in every process running
+   that executable, so the frame holding it is entered into a
+   table of shared frames, keyed by inode and offset, and other
+   processes map the same frame instead of reading their own
+   copy.  The frame is freed once none of them maps it. */
+struct frame
+  {
+    struct lock lock;           /* Pins the frame. */
+    void *base;                 /* Kernel virtual base address. */
+    struct list pages;          /* Pages mapped here; empty if free. */
+
+    /* Shared frames only. */
+    struct inode *inode;        /* File inode, or a null pointer. */
+    off_t offset;               /* Offset of page in file. */
+    struct hash_elem hash_elem; /* Element in shared frame table. */
+  };
+
+void frame_init (void);
+
+struct frame *frame_alloc_and_lock (struct page *);
+struct frame *frame_lock_shared (struct page *, struct inode *, off_t);
+void frame_share (struct frame *, struct inode *, off_t);
+void frame_lock (struct page *);
+
+void frame_free (struct page *);
+void frame_unlock (struct frame *);
+
+#endif /* vm/frame.h */
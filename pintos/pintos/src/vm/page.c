@@ -0,0 +1,355 @@
+#include "vm/page.h"
+#include <debug.h>
+#include <string.h>
+#include "vm/frame.h"
+#include "vm/swap.h"
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+
+/* Largest size, in bytes, to which a process's stack may grow. */
+size_t page_stack_max = 8 * 1024 * 1024;
+
+/* How far below the stack pointer an access may fall and still
+   grow the stack: PUSHA pushes 32 bytes before it updates %esp. */
+#define STACK_SLOP 32
+
+/* Destroys a page, which must be in the current process's
+   page table.  Used as a callback for hash_destroy(). */
+static void
+destroy_page (struct hash_elem *p_, void *aux UNUSED)
+{
+  struct page *p = hash_entry (p_, struct page, hash_elem);
+  frame_lock (p);
+  if (p->frame)
+    {
+      pagedir_clear_page (p->thread->pagedir, p->addr);
+      frame_free (p);
+    }
+  swap_discard (p);
+  free (p);
+}
+
+/* Destroys the current process's page table. */
+void
+page_exit (void)
+{
+  struct hash *h = thread_current ()->pages;
+  if (h != NULL)
+    {
+      hash_destroy (h, destroy_page);
+      free (h);
+      thread_current ()->pages = NULL;
+    }
+}
+
+/* Returns true if ADDRESS is where the current process's stack
+   may grow: within page_stack_max bytes of the top of user
+   memory, and not too far below the user stack pointer saved on
+   entry to the kernel. */
+static bool
+is_stack_growth (const void *address)
+{
+  const uint8_t *esp = thread_current ()->user_esp;
+
+  return ((const uint8_t *) address >= (const uint8_t *) PHYS_BASE
+                                        - page_stack_max
+          && esp != NULL
+          && (const uint8_t *) address + STACK_SLOP >= esp);
+}
+
+/* Returns the page containing the given virtual ADDRESS,
+   or a null pointer if no such page exists.  Allocates stack
+   pages as necessary, to be zeroed when first touched. */
+static struct page *
+page_for_addr (const void *address)
+{
+  struct hash *h = thread_current ()->pages;
+
+  if (h != NULL && is_user_vaddr (address))
+    {
+      struct page p;
+      struct hash_elem *e;
+
+      /* Find existing page. */
+      p.addr = (void *) pg_round_down (address);
+      e = hash_find (h, &p.hash_elem);
+      if (e != NULL)
+        return hash_entry (e, struct page, hash_elem);
+
+      /* No page.  Expand stack? */
+      if (is_stack_growth (address))
+        return page_allocate ((void *) address, false);
+    }
+  return NULL;
+}
+
+/* Returns true if page P may share its frame with the same page
+   of other processes running the same executable: that is, if
+   it is a read-only page of a file, which can never change. */
+static bool
+is_shareable (const struct page *p)
+{
+  return p->read_only && p->file != NULL;
+}
+
+/* Locks a frame for page P and pages it in.
+   Returns true if successful, false on failure. */
+static bool
+do_page_in (struct page *p)
+{
+  /* Use the frame of another process's copy of the page, if it
+     is in memory. */
+  if (is_shareable (p))
+    {
+      p->frame = frame_lock_shared (p, file_get_inode (p->file),
+                                    p->file_offset);
+      if (p->frame != NULL)
+        return true;
+    }
+
+  /* Get a frame for the page. */
+  p->frame = frame_alloc_and_lock (p);
+  if (p->frame == NULL)
+    return false;
+
+  /* Copy data into the frame. */
+  if (p->sector != (block_sector_t) -1)
+    {
+      /* Get data from swap. */
+      swap_in (p);
+    }
+  else if (p->file != NULL)
+    {
+      /* Get data from file. */
+      off_t read_bytes = file_read_at (p->file, p->frame->base,
+                                        p->file_bytes, p->file_offset);
+      if (read_bytes != p->file_bytes)
+        {
+          frame_free (p);
+          return false;
+        }
+      memset (p->frame->base + read_bytes, 0, PGSIZE - read_bytes);
+      if (is_shareable (p))
+        frame_share (p->frame, file_get_inode (p->file), p->file_offset);
+    }
+  else
+    {
+      /* Provide all-zero page. */
+      memset (p->frame->base, 0, PGSIZE);
+    }
+
+  return true;
+}
+
+/* Faults in the page containing FAULT_ADDR.
+   Returns true if successful, false on failure. */
+bool
+page_in (void *fault_addr)
+{
+  struct page *p;
+  bool success;
+
+  p = page_for_addr (fault_addr);
+  if (p == NULL)
+    return false;
+
+  frame_lock (p);
+  if (p->frame == NULL)
+    {
+      if (!do_page_in (p))
+        return false;
+    }
+  ASSERT (lock_held_by_current_thread (&p->frame->lock));
+
+  /* Install frame into page table. */
+  success = pagedir_set_page (thread_current ()->pagedir, p->addr,
+                              p->frame->base, !p->read_only);
+
+  /* Release frame. */
+  if (success)
+    frame_unlock (p->frame);
+  else
+    frame_free (p);
+
+  return success;
+}
+
+/* Evicts page P, saving its data if necessary.  The caller
+   removes P from its frame afterward.
+   P must have a locked frame.
+   Return true if successful, false on failure. */
+bool
+page_out (struct page *p)
+{
+  bool dirty;
+  bool ok = false;
+
+  ASSERT (p->frame != NULL);
+  ASSERT (lock_held_by_current_thread (&p->frame->lock));
+
+  /* Mark page not present in page table, forcing accesses by the
+     process to fault.  This must happen before checking the
+     dirty bit, to prevent a race with the process dirtying the
+     page. */
+  pagedir_clear_page (p->thread->pagedir, p->addr);
+
+  /* Has the frame been modified? */
+  dirty = pagedir_is_dirty (p->thread->pagedir, p->addr);
+
+  /* A page with no file must go to swap, even if clean, since
+     its contents exist nowhere else.  A modified page of a
+     memory-mapped file is written back to the file; other
+     modified file pages, such as an executable's data, go to
+     swap.  An unmodified file page can simply be read from its
+     file again. */
+  if (p->file == NULL)
+    ok = swap_out (p);
+  else if (dirty)
+    {
+      if (p->private)
+        ok = swap_out (p);
+      else
+        ok = (file_write_at (p->file, p->frame->base, p->file_bytes,
+                             p->file_offset) == p->file_bytes);
+    }
+  else
+    ok = true;
+
+  return ok;
+}
+
+/* Returns true if page P's data has been accessed recently,
+   false otherwise.
+   P must have a frame locked into memory. */
+bool
+page_accessed_recently (struct page *p)
+{
+  bool was_accessed;
+
+  ASSERT (p->frame != NULL);
+  ASSERT (lock_held_by_current_thread (&p->frame->lock));
+
+  was_accessed = pagedir_is_accessed (p->thread->pagedir, p->addr);
+  if (was_accessed)
+    pagedir_set_accessed (p->thread->pagedir, p->addr, false);
+  return was_accessed;
+}
+
+/* Adds a mapping for user virtual address VADDR to the page hash
+   table.  Fails if VADDR is not a user address, if it is already
+   mapped, or if memory allocation fails. */
+struct page *
+page_allocate (void *vaddr, bool read_only)
+{
+  struct thread *t = thread_current ();
+  struct page *p;
+
+  if (!is_user_vaddr (vaddr))
+    return NULL;
+
+  p = malloc (sizeof *p);
+  if (p != NULL)
+    {
+      p->addr = pg_round_down (vaddr);
+
+      p->read_only = read_only;
+
+      p->frame = NULL;
+
+      p->sector = (block_sector_t) -1;
+
+      p->private = !read_only;
+      p->file = NULL;
+      p->file_offset = 0;
+      p->file_bytes = 0;
+
+      p->thread = thread_current ();
+
+      if (hash_insert (t->pages, &p->hash_elem) != NULL)
+        {
+          /* Already mapped. */
+          free (p);
+          p = NULL;
+        }
+    }
+  return p;
+}
+
+/* Evicts the page containing address VADDR
+   and removes it from the page table.  A modified page of a
+   memory-mapped file is written back first. */
+void
+page_deallocate (void *vaddr)
+{
+  struct page *p = page_for_addr (vaddr);
+  ASSERT (p != NULL);
+  frame_lock (p);
+  if (p->frame)
+    {
+      if (p->file && !p->private)
+        page_out (p);
+      else
+        pagedir_clear_page (p->thread->pagedir, p->addr);
+      frame_free (p);
+    }
+  swap_discard (p);
+  hash_delete (thread_current ()->pages, &p->hash_elem);
+  free (p);
+}
+
+/* Returns a hash value for the page that E refers to. */
+unsigned
+page_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct page *p = hash_entry (e, struct page, hash_elem);
+  return ((uintptr_t) p->addr) >> PGBITS;
+}
+
+/* Returns true if page A precedes page B. */
+bool
+page_less (const struct hash_elem *a_, const struct hash_elem *b_,
+           void *aux UNUSED)
+{
+  const struct page *a = hash_entry (a_, struct page, hash_elem);
+  const struct page *b = hash_entry (b_, struct page, hash_elem);
+
+  return a->addr < b->addr;
+}
+
+/* Tries to lock the page containing ADDR into physical memory.
+   If WILL_WRITE is true, the page must be writeable;
+   otherwise it may be read-only.
+   Returns true if successful, false on failure. */
+bool
+page_lock (const void *addr, bool will_write)
+{
+  struct page *p = page_for_addr (addr);
+  if (p == NULL || (p->read_only && will_write))
+    return false;
+
+  frame_lock (p);
+  if (p->frame == NULL)
+    {
+      if (!do_page_in (p))
+        return false;
+      if (!pagedir_set_page (thread_current ()->pagedir, p->addr,
+                             p->frame->base, !p->read_only))
+        {
+          frame_free (p);
+          return false;
+        }
+    }
+  return true;
+}
+
+/* Unlocks a page locked with page_lock(). */
+void
+page_unlock (const void *addr)
+{
+  struct page *p = page_for_addr (addr);
+  ASSERT (p != NULL);
+  frame_unlock (p->frame);
+}
@@ -0,0 +1,61 @@
+#ifndef VM_PAGE_H
+#define VM_PAGE_H
+
+#include <hash.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "devices/block.h"
+#include "filesys/off_t.h"
+
+/* A page of a process's virtual memory.
+
+   Each process has a supplemental page table, a hash of these
+   keyed by user virtual address, describing every page it may
+   access.  A page is brought into a frame only when it is first
+   touched: from swap if it was swapped out, otherwise from FILE
+   if it has one, otherwise as zeros. */
+struct page
+  {
+    /* Immutable members. */
+    void *addr;                 /* User virtual address. */
+    bool read_only;             /* Read-only page? */
+    struct thread *thread;      /* Owning thread. */
+
+    /* Accessed only in owning process context. */
+    struct hash_elem hash_elem; /* struct thread `pages' hash element. */
+
+    /* Set and cleared only with frame->lock held. */
+    struct frame *frame;        /* Page frame, or a null pointer. */
+    struct list_elem frame_elem; /* Element in frame's `pages' list. */
+
+    /* Swap information, protected by frame->lock. */
+    block_sector_t sector;      /* Starting sector of swap area, or -1. */
+
+    /* Memory-mapped file information, protected by frame->lock. */
+    bool private;               /* False to write back to file,
+                                   true to write back to swap. */
+    struct file *file;          /* File. */
+    off_t file_offset;          /* Offset in file. */
+    off_t file_bytes;           /* Bytes to read/write, 1...PGSIZE. */
+  };
+
+/* Largest size, in bytes, to which a process's stack may grow.
+   Set by the "-stack" kernel option. */
+extern size_t page_stack_max;
+
+void page_exit (void);
+
+struct page *page_allocate (void *, bool read_only);
+void page_deallocate (void *vaddr);
+
+bool page_in (void *fault_addr);
+bool page_out (struct page *);
+bool page_accessed_recently (struct page *);
+
+bool page_lock (const void *, bool will_write);
+void page_unlock (const void *);
+
+hash_hash_func page_hash;
+hash_less_func page_less;
+
+#endif /* vm/page.h */